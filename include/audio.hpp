@@ -4,4 +4,20 @@
 #include "audio/monosignal.hpp"
 #include "audio/wav.hpp"
 #include "audio/wave_data.hpp"
+#include "audio/spectrogram.hpp"
+#include "audio/spectrogram_pyramid.hpp"
+#include "audio/spectrogram_file.hpp"
+#include "audio/simd.hpp"
+#include "audio/table_cache.hpp"
+#include "audio/window.hpp"
+#include "audio/fft.hpp"
+#include "audio/thread_pool.hpp"
+#include "audio/stft_stream.hpp"
+#include "audio/sliding_dft.hpp"
+#include "audio/goertzel.hpp"
 #include "audio/fourier.hpp"
+#include "audio/cqt.hpp"
+#include "audio/czt.hpp"
+#include "audio/peaks.hpp"
+#include "audio/partials.hpp"
+#include "audio/convolution.hpp"
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <complex>
+#include <concepts>
+#include <cstdint>
+#include <vector>
+
+#include "audio/fft.hpp"
+#include "audio/monosignal.hpp"
+
+namespace audio {
+
+/**
+ * linear convolution of a signal with an impulse response, y[n] = sum_j ir[j] x[n - j], all n_samples + n_ir - 1
+ * samples of it
+ *
+ * short impulse responses (up to 64 taps) are done directly, longer ones with fft overlap-save: the ir is
+ * transformed once at a power of two size picked for the least work per output sample, and the signal goes through
+ * in blocks, each one an fft, a multiply and an inverse fft, so it's O((n + m) log m) instead of O(n * m).
+ * blocks are spread over thread_pool::global(), n_threads caps how many of its threads get used, and the result is
+ * the same for any thread count. T is the precision of the transforms
+ *
+ * throws std::invalid_argument for impulse responses longer than 2^30 taps
+ */
+template <std::floating_point T = double>
+std::vector<float> convolve(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t n_ir,
+    const float *ir, uint32_t ir_spacing = 1, uint32_t n_threads = 0);
+
+// same as above on a whole monosignal, the ir at the signal's sample rate
+template <std::floating_point T = double>
+monosignal convolve(const monosignal &signal, const std::vector<float> &ir, uint32_t n_threads = 0);
+
+extern template std::vector<float> convolve<float>(uint32_t, const float *, uint32_t, uint32_t, const float *,
+    uint32_t, uint32_t);
+extern template std::vector<float> convolve<double>(uint32_t, const float *, uint32_t, uint32_t, const float *,
+    uint32_t, uint32_t);
+extern template monosignal convolve<float>(const monosignal &, const std::vector<float> &, uint32_t);
+extern template monosignal convolve<double>(const monosignal &, const std::vector<float> &, uint32_t);
+
+/**
+ * streaming convolution with a fixed latency and the same cost for every block, for running long impulse
+ * responses live (e.g. from a miniaudio data callback)
+ *
+ * uniformly partitioned overlap-save: the ir is cut into partitions of block_size taps, each transformed once at
+ * 2 * block_size, and the spectra of the last n_partitions() input blocks are kept in a ring. every block_size
+ * samples that come in cost one fft of 2 * block_size, n_partitions() complex multiply-adds of block_size + 1
+ * bins and one inverse fft, however long the ir is.
+ *
+ * output lags the input by exactly block_size samples (latency()), whatever sizes process() gets called with.
+ * nothing allocates after construction, and like fft_plan an instance must not be used from several threads at once
+ */
+template <std::floating_point T = float>
+struct partitioned_convolver {
+    /**
+     * @param block_size samples per partition, also the latency. powers of two are fastest
+     * @param n_ir taps of the impulse response, ir[i * ir_spacing] being tap i
+     *
+     * throws std::invalid_argument for a block_size or n_ir of 0
+     */
+    partitioned_convolver(uint32_t block_size, uint32_t n_ir, const float *ir, uint32_t ir_spacing = 1);
+
+    /**
+     * convolves n samples, writing the n samples of output they push out. output may be the same as input
+     */
+    void process(uint32_t n, const float *input, float *output);
+
+    // clears the history, as if no samples had been processed
+    void reset();
+
+    uint32_t block_size() const {
+        return block_size_;
+    }
+    uint32_t latency() const {
+        return block_size_;
+    }
+    uint32_t n_partitions() const {
+        return n_partitions_;
+    }
+
+private:
+    void process_block();
+
+    uint32_t block_size_;
+    uint32_t n_partitions_;
+    rfft_plan<T> plan_;
+    std::vector<std::complex<T>> partitions_; // transformed ir partitions, block_size + 1 bins each, scaled by 1 / size
+    std::vector<std::complex<T>> history_; // spectra of the last n_partitions input blocks, a ring
+    uint32_t newest_; // partition slot of history_ written last
+    std::vector<std::complex<T>> sum_; // block_size + 1 bins, with room for the inverse to write 2 * block_size reals
+    std::vector<T> window_; // the last two input blocks, 2 * block_size samples, transformed into history_
+    std::vector<float> input_; // the block being filled
+    std::vector<float> output_; // the output of the last full block, being handed out
+    uint32_t pos_; // samples of input_ filled
+};
+
+extern template struct partitioned_convolver<float>;
+extern template struct partitioned_convolver<double>;
+
+}
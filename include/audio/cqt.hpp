@@ -0,0 +1,127 @@
+#pragma once
+
+#include <complex>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio/spectrogram.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+// constant-q transform of a signal, laid out like stft_result but with log spaced bins
+template <typename T>
+struct cqt_result {
+    // waves[s * n_freq + k] is bin k of frame s, bin k sitting at min_freq * 2^(k / bins_per_octave) Hz
+    // (waves.freqs() has them all), phases are the waves' phases at the middle of the frame
+    spectrogram<T> waves;
+    uint32_t n_freq; // number of bins in a frame
+    uint32_t n_signals; // number of frames
+    uint32_t bins_per_octave;
+
+    T min_freq; // frequency of bin 0
+    T max_freq; // frequency of the last bin
+    T time_delta; // time step between frames, frame s is centered at s * time_delta
+    T time_range; // time_delta * n_signals
+
+    uint32_t samples_per_sec;
+    uint32_t n_samples; // length of the signal
+    uint32_t n_window_offset;
+};
+
+/**
+ * precomputed constant-q transform: bins spaced evenly in pitch, each as wide as its distance to the next one, so
+ * low notes get long windows and high ones short windows
+ *
+ * built on the fft in the usual way (brown & puckette's spectral kernel, with schörkhuber & klapuri's octave
+ * decimation). only the top octave has a kernel: every bin's windowed complex exponential is transformed once and
+ * everything below threshold times its peak is dropped, leaving a few fft bins per cq bin. each lower octave reuses
+ * that kernel on the signal low-passed and decimated by 2 once more, so every octave costs the same small fft per
+ * frame no matter how long its windows are in real time. amplitudes and phases follow naive_ft's conventions
+ * (a wave A cos(2πft + φ) on a bin comes out with amplitude A)
+ *
+ * the kernel and decimation filter are shared by copies, like fft_plan's tables, and transform() is const, so one
+ * plan can be used from any number of threads
+ */
+template <std::floating_point T = double>
+struct cqt_plan {
+    // relative magnitude below which spectral kernel values are dropped
+    static constexpr double default_threshold = 0.0054;
+
+    /**
+     * @param min_freq frequency of the lowest bin, in Hz
+     * @param max_freq bins go up to the last one at or below this, which has to be at most 0.4 * samples_per_sec so
+     * the decimation filter's transition band stays above it
+     * @param bins_per_octave e.g. 12 for semitones, 36 for thirds of one
+     * @param win window each bin's exponential is shaped with, its length is q * samples_per_sec / bandwidth
+     * @param q scales every window's length, 1 makes each bin exactly as wide as the step to the next one
+     *
+     * throws std::invalid_argument for frequencies out of range
+     */
+    cqt_plan(uint32_t samples_per_sec, double min_freq, double max_freq, uint32_t bins_per_octave = 12,
+        const window &win = {window_type::hann}, double q = 1, double threshold = default_threshold);
+
+    /**
+     * transforms a whole signal with frames centered every n_window_offset samples, starting at sample 0, and
+     * covering the whole signal (samples outside it count as 0).
+     * frames are spread over thread_pool::global(), n_threads caps how many of its threads get used
+     */
+    cqt_result<T> transform(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t n_window_offset,
+        uint32_t n_threads = 0) const;
+
+    uint32_t n_freq() const {
+        return n_freq_;
+    }
+    uint32_t n_octaves() const {
+        return n_octaves_;
+    }
+    const std::vector<T> &freqs() const {
+        return freqs_;
+    }
+    // size of the fft every octave runs per frame
+    uint32_t fft_size() const {
+        return fft_size_;
+    }
+    // values kept in the sparse kernel, i.e. complex multiply-adds per frame and octave
+    std::size_t kernel_size() const {
+        return kernel_->values.size();
+    }
+
+private:
+    // top octave kernel, row j holds the kept values for the fft bins from first[j] on
+    struct kernel {
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> offset; // start of row j in values, with one extra at the end
+        std::vector<std::complex<T>> values; // conj(fft of the atom) / fft_size
+        std::vector<T> top_freqs; // frequencies the rows are for, at the full sample rate
+    };
+
+    uint32_t samples_per_sec_;
+    uint32_t bins_per_octave_;
+    uint32_t n_freq_;
+    uint32_t n_octaves_;
+    uint32_t fft_size_;
+    std::vector<T> freqs_;
+    std::shared_ptr<const kernel> kernel_;
+};
+
+extern template struct cqt_plan<float>;
+extern template struct cqt_plan<double>;
+
+/**
+ * one-off constant-q transform, same as cqt_plan(...).transform(...)
+ */
+template <std::floating_point T = double>
+cqt_result<T> cqt(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec,
+    uint32_t n_window_offset, double min_freq, double max_freq, uint32_t bins_per_octave = 12,
+    const window &win = {window_type::hann}, uint32_t n_threads = 0);
+
+extern template cqt_result<float> cqt<float>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, double, double,
+    uint32_t, const window &, uint32_t);
+extern template cqt_result<double> cqt<double>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, double, double,
+    uint32_t, const window &, uint32_t);
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <complex>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio/fft.hpp"
+#include "audio/fourier.hpp"
+#include "audio/wave_data.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+/**
+ * precomputed chirp-z transform of a fixed size, evaluating the spectrum of n samples at n_bins evenly spaced
+ * frequencies from min_freq to max_freq (a zoom fft). the resolution is whatever the band and n_bins make it,
+ * independent of n, so a narrow band can be looked at in as much detail as wanted without transforming a huge
+ * zero padded window.
+ *
+ * uses bluestein's identity to turn it into one convolution, done with power of two ffts of at least n + n_bins - 1
+ * points, so it costs O((n + n_bins) log(n + n_bins)) against O(n * n_bins) for evaluating every frequency directly.
+ * the window and the amplitude scaling are folded into the input chirp, and the chirp phases are reduced exactly
+ * (like goertzel_bank's rotation) so large n don't lose precision
+ *
+ * like fft_plan, a plan owns its scratch and must not be run from several threads at once, copies are independent
+ */
+template <std::floating_point T = double>
+struct czt_plan {
+    /**
+     * @param n_samples number of samples transformed each time
+     * @param min_freq, max_freq first and last frequency, in Hz, 0 <= min_freq <= max_freq <= samples_per_sec / 2
+     * (with n_bins = 1 only min_freq is used)
+     * @param win window applied to the samples, amplitudes are corrected like naive_ft's
+     *
+     * throws std::invalid_argument for sizes of 0 or frequencies out of range
+     */
+    czt_plan(uint32_t n_samples, uint32_t samples_per_sec, double min_freq, double max_freq, uint32_t n_bins,
+        const window &win = {});
+
+    /**
+     * writes the complex amplitude of every frequency to out (n_bins of them), so that |out[m]| and arg(out[m]) are
+     * the amplitude and phase naive_ft would give for a bin at that frequency (phases relative to the first sample).
+     * a frequency that's also one of naive_ft's bins gives the same wave as naive_ft up to rounding, and nyquist
+     * (for an even n_samples) gets halved like naive_stft's nyquist bin
+     */
+    void transform(const float *input, uint32_t in_spacing, std::complex<T> *out);
+
+    // same as above, as waves
+    std::vector<wave_data_t<T>> waves(const float *input, uint32_t in_spacing);
+
+    uint32_t size() const {
+        return n_;
+    }
+    uint32_t n_bins() const {
+        return m_;
+    }
+    const std::vector<T> &freqs() const {
+        return freqs_;
+    }
+
+private:
+    uint32_t n_;
+    uint32_t m_;
+    std::vector<T> freqs_;
+    fft_plan<T> plan_;
+    // shared between copies
+    std::shared_ptr<const std::vector<std::complex<T>>> pre_; // window * amp scale * e^(-2πi(min_freq n / sps + r n² / 2))
+    std::shared_ptr<const std::vector<std::complex<T>>> kernel_; // transformed e^(2πi r k² / 2), divided by the size
+    std::shared_ptr<const std::vector<std::complex<T>>> post_; // e^(-2πi r m² / 2), r = bin step / sps
+    std::vector<std::complex<T>> scratch_;
+};
+
+extern template struct czt_plan<float>;
+extern template struct czt_plan<double>;
+
+/**
+ * one-off zoom fft: the waves of n_samples samples at n_bins frequencies evenly spaced over [min_freq, max_freq]
+ * (see czt_plan)
+ */
+template <std::floating_point T = double>
+std::vector<wave_data_t<T>> zoom_ft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, double min_freq, double max_freq, uint32_t n_bins, const window &win = {});
+
+/**
+ * short-time zoom fft, naive_stft's frames (without truncate) but each one evaluated at n_bins frequencies
+ * spaced evenly over [min_freq, max_freq], which is how a viewer can zoom into a band interactively: the cost
+ * depends on the band's bin count, not on how fine the bins are.
+ *
+ * the result is laid out like naive_stft's except that bin f is at min_freq + f * freq_delta rather than
+ * f * freq_delta (waves.freqs() has the real frequencies), freq_range is n_freq * freq_delta and n_freq is n_bins.
+ * istft can't invert it, the bins don't cover the whole spectrum
+ */
+template <std::floating_point T = double>
+stft_result<T> zoom_stft(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec,
+    uint32_t n_window_offset, uint32_t n_window_size, double min_freq, double max_freq, uint32_t n_bins,
+    const window &win = {}, uint32_t n_threads = 0);
+
+extern template std::vector<wave_data> zoom_ft<double>(uint32_t, const float *, uint32_t, uint32_t, double, double,
+    uint32_t, const window &);
+extern template std::vector<wave_dataf> zoom_ft<float>(uint32_t, const float *, uint32_t, uint32_t, double, double,
+    uint32_t, const window &);
+extern template stft_result<double> zoom_stft<double>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, uint32_t,
+    double, double, uint32_t, const window &, uint32_t);
+extern template stft_result<float> zoom_stft<float>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, uint32_t,
+    double, double, uint32_t, const window &, uint32_t);
+
+}
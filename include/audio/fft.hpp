@@ -0,0 +1,130 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio/simd.hpp"
+#include "audio/table_cache.hpp"
+
+namespace audio {
+
+/**
+ * precomputed plan for a complex discrete fourier transform of a fixed size
+ *
+ * sizes are factored into radix 4, 2, 3 and 5 stages (plus a generic butterfly for other primes up to max_radix),
+ * anything with a larger prime factor goes through bluestein's algorithm on top of a smooth sized inner plan,
+ * so every size runs in O(n log n)
+ *
+ * twiddles and chirps come from table_cache::global(), so building a plan of a size that was already planned
+ * doesn't redo any trig, and copies of a plan share their tables.
+ * the plan owns its own scratch space, so a single plan must not be executed from multiple threads at once.
+ * copy the plan instead, copies are independent
+ */
+template <typename T>
+struct fft_plan {
+    // largest prime factor that gets a direct butterfly, anything bigger uses bluestein
+    static constexpr uint32_t max_radix = 31;
+
+    explicit fft_plan(uint32_t n);
+    fft_plan(const fft_plan &);
+    fft_plan(fft_plan &&) = default;
+    fft_plan &operator=(fft_plan);
+
+    uint32_t size() const {
+        return n_;
+    }
+
+    /**
+     * computes X[k] = sum_i x[i] e^(-2πi ki/n)
+     *
+     * @param input pointer to n complex samples
+     * @param output pointer to space for n complex bins, may be the same as input
+     */
+    void forward(const std::complex<T> *input, std::complex<T> *output);
+
+    /**
+     * computes x[i] = sum_k X[k] e^(2πi ki/n), note that there is no division by n
+     */
+    void inverse(const std::complex<T> *input, std::complex<T> *output);
+
+private:
+    struct stage {
+        uint32_t radix;
+        uint32_t m; // length of each of the radix sub-transforms combined in this stage
+        std::size_t twiddle_offset; // (radix - 1) * m twiddles, then radix roots if the radix is generic
+    };
+
+    void transform(std::complex<T> *output, const std::complex<T> *input, std::size_t stride, std::size_t s);
+    void bluestein(const std::complex<T> *input, std::complex<T> *output, bool conj_input);
+
+    uint32_t n_;
+    const simd::kernels<T> *kernels_;
+    std::vector<stage> stages_;
+    std::shared_ptr<const std::vector<std::complex<T>>> twiddles_;
+
+    // only used by bluestein plans
+    std::shared_ptr<const std::vector<std::complex<T>>> chirp_; // e^(-πi k²/n)
+    std::shared_ptr<const std::vector<std::complex<T>>> kernel_; // transformed conjugate chirp, pre-divided by the inner size
+    std::unique_ptr<fft_plan> inner_;
+
+    std::vector<std::complex<T>> scratch_;
+};
+
+extern template struct fft_plan<float>;
+extern template struct fft_plan<double>;
+
+/**
+ * precomputed plan for the fourier transform of a real signal of fixed size
+ *
+ * for even n, the samples are packed into n / 2 complex numbers (evens as real, odds as imaginary),
+ * transformed with a half sized fft_plan and then split apart with a post-twiddle pass,
+ * so it takes about half the time and memory of the equivalent complex transform.
+ * odd n falls back to a full complex transform
+ *
+ * like fft_plan, a single plan must not be executed from multiple threads at once
+ */
+template <typename T>
+struct rfft_plan {
+    explicit rfft_plan(uint32_t n);
+
+    uint32_t size() const {
+        return n_;
+    }
+
+    // number of bins in the output, n / 2 + 1 (the rest follow from X[n - k] = conj(X[k]))
+    uint32_t n_bins() const {
+        return n_ / 2 + 1;
+    }
+
+    /**
+     * computes X[k] = sum_i x[i] e^(-2πi ki/n) for k = 0 to n / 2
+     *
+     * @param input pointer to n real samples
+     * @param output pointer to space for n_bins() complex bins,
+     * may overlap input as long as output starts at input (i.e. the buffer holds at least n + 2 reals)
+     */
+    void forward(const T *input, std::complex<T> *output);
+
+    /**
+     * computes x[i] = sum_k X[k] e^(2πi ki/n) over all n bins, taking X[n - k] = conj(X[k]) for the ones not given,
+     * so the result is real. like fft_plan::inverse there is no division by n.
+     * the imaginary parts of X[0] (and X[n / 2] for even n) are ignored
+     *
+     * @param input pointer to n_bins() complex bins
+     * @param output pointer to space for n real samples, may start at input like forward's
+     */
+    void inverse(const std::complex<T> *input, T *output);
+
+private:
+    uint32_t n_;
+    fft_plan<T> half_;
+    std::shared_ptr<const std::vector<std::complex<T>>> twiddles_; // e^(-2πi k/n) for k = 0 to n / 4
+    std::vector<std::complex<T>> scratch_; // only used by odd sizes
+};
+
+extern template struct rfft_plan<float>;
+extern template struct rfft_plan<double>;
+
+}
\ No newline at end of file
@@ -1,15 +1,22 @@
 #pragma once
 
+#include <concepts>
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <tuple>
 #include <vector>
 
+#include "audio/monosignal.hpp"
+#include "audio/spectrogram.hpp"
 #include "audio/wave_data.hpp"
+#include "audio/window.hpp"
 
 namespace audio {
 
 /**
- * naive implementation of the fourier transform
+ * discrete fourier transform of a real signal
+ * (originally a naive O(n²) loop, now computed with an fft_plan in O(n log n), the name stuck)
  * 
  * @param n_samples is the number of sample points in input
  * @param input pointer to the input samples, pointed at the first sample
@@ -17,18 +24,67 @@ namespace audio {
  * 
  * @param samples_per_sec samples in a second, used for final frequency calculation
  * 
+ * @param win window to multiply the input by before transforming, amplitudes are corrected by the window's
+ * coherent gain (the sum of its coefficients), so a wave sitting on a bin still comes out with its true amplitude
+ * 
  * @return a vector containing wave_data representing all of the waves in the signal
  * (waves are of form with A cos(2πft + φ))
+ *
+ * T is the precision the transform runs in, naive_ft<float>(...) runs the whole fft in float at twice the simd lanes.
+ * measured against double on white noise and on sums of sines (n from 1000 to 2^20, hann window), float keeps every
+ * amplitude within 1e-7 to 3e-7 of the largest amplitude in the signal (5e-7 for large prime n, which go through
+ * bluestein), and phases within about 3e-7 radians divided by the bin's amplitude relative to the largest.
+ * so for displays or peak picking down to about -100 dB float is plenty, anything that needs the phases of quiet
+ * bins (phase vocoders, istft of edited spectra) wants double
  */
-std::vector<wave_data> naive_ft(uint32_t n_samples, const float *input, uint32_t in_spacing,
-    uint32_t samples_per_sec);
+template <std::floating_point T = double>
+std::vector<wave_data_t<T>> naive_ft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, const window &win = {});
+
+extern template std::vector<wave_data> naive_ft<double>(uint32_t, const float *, uint32_t, uint32_t, const window &);
+extern template std::vector<wave_dataf> naive_ft<float>(uint32_t, const float *, uint32_t, uint32_t, const window &);
+
+/**
+ * like naive_ft, but with the window given as a policy, e.g. naive_ft<hann_window>(...)
+ */
+template <window_policy W, std::floating_point T = double>
+std::vector<wave_data_t<T>> naive_ft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec) {
+    return naive_ft<T>(n_samples, input, in_spacing, samples_per_sec, W::value);
+}
 
 /**
  * like naive_ft, but using a hanning window to limit spectral leakage
+ * same as naive_ft<hann_window>
  */
 std::vector<wave_data> naive_ft_hann(uint32_t n_samples, const float *input, uint32_t in_spacing,
     uint32_t samples_per_sec);
 
+/**
+ * naive_ft over many signals of the same length at once, sharing one plan, one window table and one set of buffers
+ * per thread, with the signals spread over thread_pool::global()
+ *
+ * @param n_signals is the number of signals
+ * @param n_samples is the number of sample points in each signal
+ * @param input pointer to the first sample of the first signal
+ * @param signal_stride offset between the first samples of consecutive signals in input
+ * @param in_spacing offset between each sample of a signal
+ *
+ * samples_per_sec, win and T are the same as naive_ft's, n_threads the same as naive_stft's
+ *
+ * @return one frame per signal of (n_samples - 1) / 2 + 1 bins, frame s holding what naive_ft would give for
+ * signal s (to rounding, amplitudes and phases are only worked out from the bins when asked for).
+ * signals of 0 samples give frames of 0 bins
+ */
+template <std::floating_point T = double>
+spectrogram<T> batch_ft(uint32_t n_signals, uint32_t n_samples, const float *input, std::size_t signal_stride,
+    uint32_t in_spacing, uint32_t samples_per_sec, const window &win = {}, uint32_t n_threads = 0);
+
+extern template spectrogram<double> batch_ft<double>(uint32_t, uint32_t, const float *, std::size_t, uint32_t,
+    uint32_t, const window &, uint32_t);
+extern template spectrogram<float> batch_ft<float>(uint32_t, uint32_t, const float *, std::size_t, uint32_t,
+    uint32_t, const window &, uint32_t);
+
 /**
  * like naive_ft, but running calculations on the gpu
  */
@@ -37,8 +93,10 @@ std::vector<wave_dataf> naive_ft_gpu(uint32_t n_samples, const float *input, uin
 
 template <typename T>
 struct stft_result {
-    std::vector<wave_data_t<T>> waves; // big vector containing all wave data of all regular sized signals
-    uint32_t n_freq; // number of frequencies in a standard signal 
+    // spectra of all signals, waves[s * n_freq + f] is still the wave_data of frequency f of signal s
+    // but the frames are stored as complex amplitudes, see spectrogram
+    spectrogram<T> waves;
+    uint32_t n_freq; // number of frequencies in a signal, n_window_size / 2 + 1 (nyquist included) for naive_stft
     uint32_t n_signals; // number of signals in waves, waves.size() = n_freq * n_signals
     
     T freq_delta; // step in Hz between each wave_data in a signal = 1 / duration
@@ -46,11 +104,21 @@ struct stft_result {
     T time_delta; // time step between each signal
     T time_range; // time_delta * n_signals
 
-    // vector containing vectors of wave datas for truncated signals with variable lengths
-    // truncated signals are ordered in time
-    // in naive_stft calls with truncate = false, this be empty
-    std::vector<std::vector<wave_data_t<T>>> trunc_waves;
-    uint32_t n_total_signals; // n_signals + trunc_waves.size()
+    // signals that fit in the input, the ones after them are the zero padded tail from truncate = true
+    // (so with truncate = false, this is n_signals)
+    uint32_t n_full_signals;
+
+    // what the transform was run with, everything istft needs to undo it
+    uint32_t samples_per_sec;
+    uint32_t n_samples; // length of the signal
+    uint32_t n_window_size;
+    uint32_t n_window_offset;
+    window win;
+
+    // samples of the input in signal s, n_window_size for every signal but the zero padded ones
+    uint32_t frame_samples(uint32_t s) const {
+        return uint32_t(std::min<uint64_t>(n_window_size, n_samples - uint64_t(s) * n_window_offset));
+    }
 };
 
 /**
@@ -65,15 +133,65 @@ struct stft_result {
  * @param n_window_offset is the offset between windows in the short-time fourier transform in samples
  * @param truncate is whether or not to perform the ft on windows with less than the asked number of samples.
  * if truncate is false, then this will skip windows at the end with less than the required number of samples
- * if truncate is true, then this will not skip windows at the end with less than the required number of samples
+ * if truncate is true, then every window that starts before the end of the input gets a signal, the ones running
+ * past the end are filled up with zeros (and windowed like the rest), so every signal has the same n_freq bins on the
+ * same frequency grid. result.frame_samples(s) tells how many of a signal's samples are real
  * @param n_window_size is the size of the window to perform the fourier transform on.
  * if window_size is given as 0, then it is defaulted to n_samples/n_window_offset
+ * @param win window function applied to every window, with the same amplitude correction as naive_ft
+ * @param n_threads caps the number of threads thread_pool::global() used to transform windows in parallel,
+ * 0 uses all of them. the result is identical for any thread count
  * 
  * @return a vector containing pairs of window start time and info of the waves the window.
  * (waves are of form with A cos(2πft + φ))
+ * every signal has n_window_size / 2 + 1 waves, one more than naive_ft for even window sizes: the nyquist bin is
+ * kept (with its amplitude halved like 0 Hz's) so istft can undo the transform exactly
+ *
+ * T is the precision, with the same accuracy as naive_ft's. naive_stft<float> halves the memory of the result too
  */
-stft_result<double> naive_stft(uint32_t n_samples, const float *input, uint32_t in_spacing,
-    uint32_t samples_per_sec, uint32_t n_window_offset, bool truncate = false, uint32_t n_window_size = 0);
+template <std::floating_point T = double>
+stft_result<T> naive_stft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, uint32_t n_window_offset, bool truncate = false, uint32_t n_window_size = 0,
+    const window &win = {}, uint32_t n_threads = 0);
+
+extern template stft_result<double> naive_stft<double>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, bool,
+    uint32_t, const window &, uint32_t);
+extern template stft_result<float> naive_stft<float>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, bool,
+    uint32_t, const window &, uint32_t);
+
+/**
+ * like naive_stft, but with the window given as a policy, e.g. naive_stft<hann_window>(...)
+ */
+template <window_policy W, std::floating_point T = double>
+stft_result<T> naive_stft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, uint32_t n_window_offset, bool truncate = false, uint32_t n_window_size = 0,
+    uint32_t n_threads = 0) {
+    return naive_stft<T>(n_samples, input, in_spacing, samples_per_sec, n_window_offset, truncate, n_window_size,
+        W::value, n_threads);
+}
+
+/**
+ * inverse of naive_stft, turns the frames of result back into a signal by windowed overlap-add
+ *
+ * every frame is inverse transformed in O(n log n), multiplied by the window again and added in at its offset,
+ * then each sample is divided by the sum of the squared window over the frames covering it. for a result straight
+ * out of naive_stft or stft_stream (which keep every bin, nyquist included) this gives back the original samples
+ * (up to rounding) wherever that sum isn't tiny. where it is (the ends of the signal, or everywhere between frames
+ * if the offset is too big for the window) the divisor is floored at 1e-3 of its largest value, so those samples
+ * fade out instead of blowing up, and samples no frame covers are 0. for edited spectra, pick a window and offset
+ * that pass is_cola, otherwise the varying normalization shows up as amplitude ripple at the frame rate
+ *
+ * the signal is result.n_samples long, samples no frame covers (the tail cut off when truncate was false) are 0.
+ * zero padded frames are inverted like any other, their padding just falls past the end of the signal
+ *
+ * an empty result gives an empty signal.
+ * throws std::invalid_argument if the frames leave gaps (n_window_offset > n_window_size) or the offset is 0
+ */
+template <typename T>
+monosignal istft(const stft_result<T> &result, uint32_t n_threads = 0);
+
+extern template monosignal istft<float>(const stft_result<float> &, uint32_t);
+extern template monosignal istft<double>(const stft_result<double> &, uint32_t);
 
 /**
  * like naive_stft, but running calculations on the gpu
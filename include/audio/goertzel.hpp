@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "audio/wave_data.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+/**
+ * goertzel filters for a fixed list of frequencies, for when only a few of them matter
+ *
+ * costs O(n_samples * frequencies) instead of a whole transform, so it wins over naive_ft for up to a few dozen
+ * frequencies. frequencies can be anything, not just multiples of samples_per_sec / n_samples, and the filters
+ * for different frequencies run side by side in simd registers.
+ *
+ * like any goertzel, rounding errors grow with the block length for frequencies close to 0 Hz or nyquist
+ */
+struct goertzel_bank {
+    // freqs in Hz, in any order, each below samples_per_sec / 2
+    goertzel_bank(uint32_t samples_per_sec, std::vector<double> freqs);
+
+    /**
+     * evaluates every frequency over one block of samples, independent of the streaming state below
+     *
+     * @return one wave_data per frequency in the order they were given, with the same amplitude and phase
+     * conventions as naive_ft (so on-bin frequencies give exactly naive_ft's waves for them)
+     */
+    std::vector<wave_data> transform(uint32_t n_samples, const float *input, uint32_t in_spacing,
+        const window &win = {}) const;
+
+    // adds samples to the running block, can be called any number of times with any sizes
+    void push(uint32_t n_samples, const float *input, uint32_t in_spacing);
+
+    // like transform over everything pushed since the last reset (rectangular window)
+    std::vector<wave_data> waves() const;
+    void waves(wave_data *out) const;
+
+    // starts a new block
+    void reset();
+
+    const std::vector<double> &freqs() const {
+        return freqs_;
+    }
+    uint64_t n_samples() const { // samples pushed since the last reset
+        return n_samples_;
+    }
+
+private:
+    void finish(const double *s1, const double *s2, uint64_t n_samples, double amp_scale, wave_data *out) const;
+
+    uint32_t samples_per_sec_;
+    std::vector<double> freqs_;
+    std::vector<double> coeff_; // 2 cos ω per frequency
+
+    // streaming state, one lane per frequency
+    std::vector<double> s1_;
+    std::vector<double> s2_;
+    uint64_t n_samples_;
+};
+
+}
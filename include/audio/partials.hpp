@@ -0,0 +1,86 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "audio/fourier.hpp"
+#include "audio/monosignal.hpp"
+
+namespace audio {
+
+// one partial's parameters in one frame
+struct partial_point {
+    uint32_t track; // which partial, numbered from 0 in order of birth
+    uint32_t frame;
+    float freq; // in Hz
+    float amplitude;
+    float phase; // in radians, at the middle of the frame (see partial_stream)
+};
+
+/**
+ * a signal as a set of time-varying sinusoids (partials), each one a run of points in consecutive frames
+ *
+ * frame s is the stft frame starting at sample s * n_window_offset, and its points hold the partials' values at
+ * its middle, sample s * n_window_offset + n_window_size / 2, which is where synthesize_partials puts them
+ */
+struct partial_stream {
+    std::vector<partial_point> points; // sorted by frame, then by track
+    uint32_t n_tracks;
+    uint32_t n_frames;
+
+    uint32_t samples_per_sec;
+    uint32_t n_samples; // length of the signal the partials came from
+    uint32_t n_window_size;
+    uint32_t n_window_offset;
+
+    // sample frame s's points are at
+    double frame_center(uint32_t s) const {
+        return double(s) * n_window_offset + n_window_size / 2.;
+    }
+};
+
+/**
+ * mcaulay-quatieri partial tracking over the frames of an stft
+ *
+ * every frame's peaks (find_peaks with gaussian interpolation, so a hann or similar window works best) are matched
+ * to the partials alive in the previous frame, closest frequency first, as long as they're within max_jump Hz.
+ * partials left without a peak die, peaks left without a partial start new ones. partials that live for fewer than
+ * min_length frames are dropped as noise and the rest are numbered in order of birth.
+ *
+ * @param max_peaks loudest peaks looked at per frame, i.e. the most partials alive at once
+ * @param min_amplitude peaks quieter than this are ignored
+ * @param n_threads caps the threads of thread_pool::global() used to find the peaks, the matching is sequential
+ */
+template <std::floating_point T>
+partial_stream track_partials(const stft_result<T> &result, uint32_t max_peaks = 60, double max_jump = 50,
+    double min_amplitude = 1e-4, uint32_t min_length = 3, uint32_t n_threads = 0);
+
+extern template partial_stream track_partials<float>(const stft_result<float> &, uint32_t, double, double, uint32_t,
+    uint32_t);
+extern template partial_stream track_partials<double>(const stft_result<double> &, uint32_t, double, double,
+    uint32_t, uint32_t);
+
+/**
+ * renders partials back into a signal of n_samples samples
+ *
+ * between two frames each partial's amplitude goes linearly and its phase follows mcaulay-quatieri's cubic, the
+ * smoothest one that meets both frames' frequencies and phases. partials fade in over the hop before their first
+ * frame and out over the hop after their last, at a constant frequency.
+ * the cost is O(n_samples * partials alive), against O(n_samples * bins) for generate_monosignal over full spectra.
+ * the hops are spread over thread_pool::global() and each one is rendered on its own, so the result is the same for
+ * any thread count
+ */
+monosignal synthesize_partials(const partial_stream &, uint32_t n_threads = 0);
+
+/**
+ * partial stream files: a small header with partial_stream's sizes, then every point as 20 bytes (track, frame,
+ * freq, amplitude, phase, as u32, u32 and three floats) in the order of points, in the writing machine's byte order
+ *
+ * both throw std::runtime_error if the file can't be written/read or isn't a partial stream of this version
+ */
+void write_partials_to_file(const std::filesystem::path &, const partial_stream &);
+partial_stream read_partials_from_file(const std::filesystem::path &);
+
+}
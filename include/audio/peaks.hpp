@@ -0,0 +1,75 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <vector>
+
+#include "audio/fourier.hpp"
+#include "audio/spectrogram.hpp"
+#include "audio/wave_data.hpp"
+
+namespace audio {
+
+/**
+ * how a peak's frequency, amplitude and phase get refined from its bin and the two next to it
+ *
+ * measured on single off-bin sines, worst of 200 (frequency error in bins, relative amplitude error):
+ * hann: quadratic 0.05 bins/6.5%, gaussian 0.016 bins/3.8%. blackman-harris: quadratic 0.034/2.8%, gaussian
+ * 0.003/0.4%. a rectangular window's peaks are too sharp for either, they only get within 0.17 bins/27%
+ */
+enum class peak_interpolation {
+    none, // the bin as it is
+    quadratic, // parabola through the three amplitudes
+    gaussian, // parabola through the three log amplitudes, exact for a gaussian window
+};
+
+/**
+ * the k loudest spectral peaks of a spectrum, loudest first
+ *
+ * a peak is a bin louder than both neighbours (the first of a flat top counts) that's also the loudest peak within
+ * min_separation Hz on either side, so the skirts and sidelobes of one loud wave don't take up the whole budget.
+ * finding them is O(n) (local maxima, a sliding max over them for the separation, nth_element for the top k),
+ * only the k that are kept get sorted.
+ *
+ * interpolation moves each peak off its bin by δ bins (|δ| <= 1/2), frequencies go to freq + δ times the spacing
+ * around the bin, amplitudes to the fitted parabola's top, and phases are corrected by -πδ for the half window of
+ * delay a symmetric window puts between the first sample and the window's centre, so a wave between two bins comes
+ * out with (close to) its real frequency, amplitude and phase instead of the nearest bin's. peaks on the first or
+ * last bin aren't interpolated
+ *
+ * @param spectrum waves sorted by frequency, e.g. from naive_ft
+ */
+template <std::floating_point T>
+std::vector<wave_data_t<T>> find_peaks(const std::vector<wave_data_t<T>> &spectrum, uint32_t k,
+    double min_separation = 0, peak_interpolation interpolation = peak_interpolation::gaussian);
+
+/**
+ * same as above for one frame of a spectrogram, only the peaks' phases get computed
+ */
+template <std::floating_point T>
+std::vector<wave_data_t<T>> find_peaks(const spectrogram<T> &waves, uint32_t frame, uint32_t k,
+    double min_separation = 0, peak_interpolation interpolation = peak_interpolation::gaussian);
+
+/**
+ * peaks of every frame of an stft, out[s] holding frame s's, with phases relative to the frame's first sample
+ * like the stft's. frames are spread over thread_pool::global(), n_threads caps how many of its threads get used
+ */
+template <std::floating_point T>
+std::vector<std::vector<wave_data_t<T>>> find_peaks(const stft_result<T> &result, uint32_t k,
+    double min_separation = 0, peak_interpolation interpolation = peak_interpolation::gaussian,
+    uint32_t n_threads = 0);
+
+extern template std::vector<wave_dataf> find_peaks<float>(const std::vector<wave_dataf> &, uint32_t, double,
+    peak_interpolation);
+extern template std::vector<wave_data> find_peaks<double>(const std::vector<wave_data> &, uint32_t, double,
+    peak_interpolation);
+extern template std::vector<wave_dataf> find_peaks<float>(const spectrogram<float> &, uint32_t, uint32_t, double,
+    peak_interpolation);
+extern template std::vector<wave_data> find_peaks<double>(const spectrogram<double> &, uint32_t, uint32_t, double,
+    peak_interpolation);
+extern template std::vector<std::vector<wave_dataf>> find_peaks<float>(const stft_result<float> &, uint32_t, double,
+    peak_interpolation, uint32_t);
+extern template std::vector<std::vector<wave_data>> find_peaks<double>(const stft_result<double> &, uint32_t, double,
+    peak_interpolation, uint32_t);
+
+}
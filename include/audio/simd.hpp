@@ -0,0 +1,72 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+
+namespace audio::simd {
+
+// instruction set levels, in order of increasing width
+enum class isa {
+    scalar,
+    sse2,
+    avx2, // also requires fma
+    avx512, // avx512f
+};
+
+const char *isa_name(isa);
+
+/**
+ * table of the vectorized inner loops used by the transforms, one per instruction set level
+ * complex arrays are interleaved (re, im) pairs, nothing needs to be aligned
+ */
+template <typename T>
+struct kernels {
+    isa level;
+
+    // data[i] *= tw[i] for i < n
+    void (*twiddle_mul)(std::size_t n, std::complex<T> *data, const std::complex<T> *tw);
+
+    // acc[i] += a[i] * b[i] for i < n
+    void (*complex_mac)(std::size_t n, std::complex<T> *acc, const std::complex<T> *a, const std::complex<T> *b);
+
+    // twiddle-free radix p butterflies across p rows of length m, row q starting at data + q * m
+    void (*butterfly2)(std::size_t m, std::complex<T> *data);
+    void (*butterfly3)(std::size_t m, std::complex<T> *data);
+    void (*butterfly4)(std::size_t m, std::complex<T> *data);
+    void (*butterfly5)(std::size_t m, std::complex<T> *data);
+
+    // output[i] = input[i * in_spacing] * window[i] for i < n, window may be nullptr for a rectangular window
+    void (*window_apply)(std::size_t n, const float *input, std::size_t in_spacing, const T *window, T *output);
+
+    // runs the goertzel recurrence s = input[i * in_spacing] * window[i] + coeff[j] * s1[j] - s2[j] over n samples
+    // for each of n_freqs frequencies, then shifts s into s1 and s1 into s2. window may be nullptr
+    void (*goertzel)(std::size_t n, const float *input, std::size_t in_spacing, const T *window, std::size_t n_freqs,
+        const T *coeff, T *s1, T *s2);
+
+    // output[i] += Re(z[j] step[j]^i) summed over n_partials partials, for i < n, with z and step given as separate
+    // real and imaginary arrays. the powers come from a recurrence, so keep n to a few thousand and re-anchor z
+    void (*oscillate)(std::size_t n, std::size_t n_partials, const T *z_re, const T *z_im, const T *step_re,
+        const T *step_im, T *output);
+};
+
+// highest level supported by this cpu (checked through cpuid)
+isa detected_isa();
+
+/**
+ * level used by active(), decided once at startup: detected_isa(), unless the AUDIO_SIMD environment variable
+ * is set to one of scalar, sse2, avx2 or avx512. asking for more than the cpu supports falls back to detected_isa()
+ */
+isa selected_isa();
+
+/**
+ * kernels for a given level, levels above detected_isa() are clamped to it
+ * kernels_for<T>(isa::scalar) is the plain c++ reference implementation
+ */
+template <typename T>
+const kernels<T> &kernels_for(isa);
+
+// kernels for selected_isa()
+template <typename T>
+const kernels<T> &active();
+
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio/wave_data.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+/**
+ * sliding dft, for watching a few bins of a window that moves forward one sample at a time
+ *
+ * each pushed sample updates every chosen bin in O(1), instead of redoing a whole transform per hop.
+ * this is the modulated sdft (mSDFT): each bin keeps the running sum of x(m) e^(-2πikm/n) over the window, with the
+ * twiddle looked up exactly from a table instead of multiplied in recursively, so the update has no pole on the unit
+ * circle and rounding errors don't compound. the sums are kept in double, what drift is left is a random walk around
+ * 1e-16 per sample, and resync() clears it completely
+ *
+ * push doesn't allocate or lock, so it's fine to call straight from a miniaudio data callback
+ */
+struct sliding_dft {
+    /**
+     * @param n_window_size the length of the window, in samples
+     * @param bins which bins to track, each in [0, (n_window_size - 1) / 2] like naive_ft's output
+     * (bin k is at k * samples_per_sec / n_window_size Hz)
+     * @param win window function, applied in the frequency domain so it has to be a cosine sum (see cosine_sum_terms),
+     * windows with m terms track up to 2(m - 1) extra bins internally
+     *
+     * throws std::invalid_argument for bins out of range or a window that can't be applied
+     */
+    sliding_dft(uint32_t samples_per_sec, uint32_t n_window_size, std::vector<uint32_t> bins, const window &win = {});
+
+    // adds one sample, the window then ends at it
+    void push(float sample);
+
+    // adds n_samples samples, the same as pushing them one by one
+    void push(uint32_t n_samples, const float *input, uint32_t in_spacing);
+
+    /**
+     * writes the current waves of the chosen bins to out (bins().size() of them), in the same form as naive_ft would
+     * give for the last n_window_size samples pushed, with phases relative to the start of the window.
+     * samples from before the first push count as 0
+     */
+    void waves(wave_data *out) const;
+    std::vector<wave_data> waves() const;
+
+    // recomputes the sums from the samples in the window, O(n_window_size) per tracked bin
+    void resync();
+
+    // forgets every sample
+    void reset();
+
+    const std::vector<uint32_t> &bins() const {
+        return bins_;
+    }
+    uint32_t size() const {
+        return n_;
+    }
+    uint64_t n_samples() const { // samples pushed so far
+        return n_samples_;
+    }
+
+private:
+    uint32_t samples_per_sec_;
+    uint32_t n_;
+    std::vector<uint32_t> bins_;
+    std::shared_ptr<const std::vector<std::complex<double>>> roots_; // e^(-2πik/n)
+
+    // the bins actually summed (the chosen ones and their neighbours the window needs), structure of arrays
+    std::vector<uint32_t> tracked_;
+    std::vector<uint32_t> phase_; // tracked_[j] * n_samples_ mod n, so roots_[phase_[j]] is the next twiddle
+    std::vector<double> sum_re_;
+    std::vector<double> sum_im_;
+
+    // output bin i is the sum of term_weight_[t] times tracked bin term_bin_[t] for t in [term_offset_[i], term_offset_[i + 1])
+    std::vector<uint32_t> term_offset_;
+    std::vector<uint32_t> term_bin_;
+    std::vector<double> term_weight_;
+    double amp_scale_;
+
+    std::vector<float> history_; // the last n samples, sample m lives at m mod n
+    uint32_t pos_; // n_samples_ mod n
+    uint64_t n_samples_;
+};
+
+}
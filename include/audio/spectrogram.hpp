@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "audio/wave_data.hpp"
+
+namespace audio {
+
+// allocator handing out memory aligned to Align bytes, so rows can start on cache line/simd boundaries
+template <typename T, std::size_t Align>
+struct aligned_allocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = aligned_allocator<U, Align>;
+    };
+
+    aligned_allocator() = default;
+    template <typename U>
+    aligned_allocator(const aligned_allocator<U, Align> &) {}
+
+    T *allocate(std::size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T *p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <typename U>
+    bool operator==(const aligned_allocator<U, Align> &) const {
+        return true;
+    }
+};
+
+/**
+ * frames of spectra stored as structure of arrays: one frequency axis shared by every frame, then the complex
+ * amplitude of every bin as a real plane and an imaginary plane, each frame-major with every row starting on a
+ * 64 byte boundary
+ *
+ * transforms only scale their bins into these planes, amplitude (|z|) and phase (arg z) are worked out when someone
+ * asks for them, so the sqrt and atan2 stay off the transform's path, and resynthesis can use the bins as they are.
+ * the amplitude plane is computed for every frame on the first amplitudes() call after a change and kept, phases are
+ * computed on every call since most uses only look at them once. once amplitudes() has been called the spectrogram
+ * holds three full planes instead of two, 1.5 times the memory of the bins alone, until it's copied or destroyed.
+ *
+ * the cache only knows about writes through set(), touch() and the mutable_re()/mutable_im() calls themselves. a
+ * row pointer from those that's written through after a later amplitudes() call leaves the cache stale, so code
+ * that reads amplitudes and then edits bins has to call touch() (or get the rows again) after its writes
+ *
+ * operator[] still hands out whole wave_data_t by value, indexed frame * n_freq() + bin, so code written against
+ * a flat vector of waves keeps working
+ *
+ * a spectrogram can also borrow its planes (and a precomputed amplitude plane) from somewhere else, like a mapped
+ * spectrogram file, in which case reading it copies nothing and only writing to it makes a copy of its own
+ */
+template <typename T>
+struct spectrogram {
+    static constexpr std::size_t alignment = 64;
+
+    spectrogram() : n_freq_{0}, n_frames_{0}, stride_{0} {}
+
+    // n_frames frames of n_freq bins, bin k at k * freq_delta, all 0
+    spectrogram(uint32_t n_freq, uint32_t n_frames, T freq_delta) : spectrogram(std::vector<T>(n_freq), n_frames) {
+        for (uint32_t k = 0; k < n_freq; k++) {
+            freqs_[k] = k * freq_delta;
+        }
+    }
+
+    // n_frames frames with bins at any frequencies (e.g. log spaced ones), all 0
+    spectrogram(std::vector<T> freqs, uint32_t n_frames)
+        : n_freq_{uint32_t(freqs.size())}, n_frames_{n_frames}, stride_{aligned_stride(n_freq_)},
+          freqs_(std::move(freqs)) {
+        re_.resize(stride_ * n_frames);
+        im_.resize(stride_ * n_frames);
+    }
+
+    /**
+     * read-only spectrogram over planes someone else owns, which owner keeps alive as long as any copy needs them.
+     * row frame of each plane starts at frame * stride, amplitudes has to hold |re + i im| laid out the same way.
+     * mutable_re() or mutable_im() first copies the bins into planes of the spectrogram's own
+     */
+    spectrogram(std::vector<T> freqs, uint32_t n_frames, std::size_t stride, const T *re, const T *im,
+        const T *amplitudes, std::shared_ptr<const void> owner)
+        : n_freq_{uint32_t(freqs.size())}, n_frames_{n_frames}, stride_{stride}, freqs_(std::move(freqs)),
+          borrowed_{re, im, amplitudes, std::move(owner)} {}
+
+    // n_freq() rounded up so rows of T start on alignment byte boundaries
+    static std::size_t aligned_stride(uint32_t n_freq) {
+        constexpr std::size_t per_line = std::max<std::size_t>(1, alignment / sizeof(T));
+        return (n_freq + per_line - 1) / per_line * per_line;
+    }
+
+    uint32_t n_freq() const {
+        return n_freq_;
+    }
+    uint32_t n_frames() const {
+        return n_frames_;
+    }
+    // elements between the starts of consecutive rows of a plane, n_freq() rounded up to the alignment
+    // (or whatever the borrowed planes use)
+    std::size_t stride() const {
+        return stride_;
+    }
+
+    // whether the planes are borrowed, see the borrowing constructor
+    bool borrowed() const {
+        return borrowed_.owner != nullptr;
+    }
+
+    // number of bins over all frames, n_freq() * n_frames(), the same as the old flat vector's size
+    std::size_t size() const {
+        return std::size_t(n_freq_) * n_frames_;
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // frequency axis, in Hz
+    const std::vector<T> &freqs() const {
+        return freqs_;
+    }
+
+    // rows of n_freq() complex amplitudes for one frame, real and imaginary parts apart, z = amplitude * e^(i phase)
+    const T *re(uint32_t frame) const {
+        return re_data() + frame * stride_;
+    }
+    const T *im(uint32_t frame) const {
+        return im_data() + frame * stride_;
+    }
+
+    /**
+     * the same rows for filling the spectrogram in. these copy borrowed planes into owned ones and drop the cached
+     * amplitudes when called, so only use them to write. the rows they hand out must not be written to after the
+     * next amplitudes() call without a touch() afterwards
+     */
+    T *mutable_re(uint32_t frame) {
+        own();
+        touch();
+        return re_.data() + frame * stride_;
+    }
+    T *mutable_im(uint32_t frame) {
+        own();
+        touch();
+        return im_.data() + frame * stride_;
+    }
+
+    // drops the cached amplitudes, for after writing through rows that were handed out before an amplitudes() call
+    void touch() {
+        cache_.ready.store(false, std::memory_order_relaxed);
+    }
+
+    std::complex<T> bin(uint32_t frame, uint32_t bin) const {
+        std::size_t i = frame * stride_ + bin;
+        return {re_data()[i], im_data()[i]};
+    }
+
+    // row of n_freq() amplitudes for one frame, out of the cached amplitude plane (computed here if it isn't yet)
+    const T *amplitudes(uint32_t frame) const {
+        if (borrowed_.owner) {
+            return borrowed_.amplitudes + frame * stride_;
+        }
+        if (!cache_.ready.load(std::memory_order_acquire)) {
+            fill_cache();
+        }
+        return cache_.values.data() + frame * stride_;
+    }
+
+    // phases of one frame, written to out (n_freq() of them)
+    void phases(uint32_t frame, T *out) const {
+        const T *re = this->re(frame), *im = this->im(frame);
+        for (uint32_t k = 0; k < n_freq_; k++) {
+            out[k] = std::atan2(im[k], re[k]);
+        }
+    }
+
+    T amplitude(uint32_t frame, uint32_t bin) const {
+        std::size_t i = frame * stride_ + bin;
+        const T *re = re_data(), *im = im_data();
+        return std::sqrt(re[i] * re[i] + im[i] * im[i]);
+    }
+    T phase(uint32_t frame, uint32_t bin) const {
+        std::size_t i = frame * stride_ + bin;
+        return std::atan2(im_data()[i], re_data()[i]);
+    }
+
+    wave_data_t<T> at(uint32_t frame, uint32_t bin) const {
+        return {freqs_[bin], amplitude(frame, bin), phase(frame, bin)};
+    }
+    void set(uint32_t frame, uint32_t bin, const std::complex<T> &z) {
+        mutable_re(frame)[bin] = z.real();
+        mutable_im(frame)[bin] = z.imag();
+    }
+    void set(uint32_t frame, uint32_t bin, const wave_data_t<T> &wave) {
+        set(frame, bin, std::polar(wave.amplitude, wave.phase));
+    }
+
+    // flat indexing like a vector of frames back to back, i = frame * n_freq() + bin
+    wave_data_t<T> operator[](std::size_t i) const {
+        return at(uint32_t(i / n_freq_), uint32_t(i % n_freq_));
+    }
+
+    // copies one frame out as waves
+    std::vector<wave_data_t<T>> frame(uint32_t frame) const {
+        std::vector<wave_data_t<T>> waves(n_freq_);
+        for (uint32_t k = 0; k < n_freq_; k++) {
+            waves[k] = at(frame, k);
+        }
+        return waves;
+    }
+
+private:
+    using plane = std::vector<T, aligned_allocator<T, alignment>>;
+
+    // the amplitude plane, laid out like re_ and im_. copies start out without it and compute their own
+    struct amplitude_cache {
+        amplitude_cache() = default;
+        amplitude_cache(const amplitude_cache &) {}
+        amplitude_cache &operator=(const amplitude_cache &) {
+            ready.store(false, std::memory_order_relaxed);
+            return *this;
+        }
+
+        std::mutex mutex;
+        std::atomic<bool> ready{false};
+        plane values;
+    };
+
+    // planes of someone else's, all null when the spectrogram owns re_ and im_
+    struct borrowed_planes {
+        const T *re = nullptr;
+        const T *im = nullptr;
+        const T *amplitudes = nullptr;
+        std::shared_ptr<const void> owner;
+    };
+
+    const T *re_data() const {
+        return borrowed_.owner ? borrowed_.re : re_.data();
+    }
+    const T *im_data() const {
+        return borrowed_.owner ? borrowed_.im : im_.data();
+    }
+
+    // copies borrowed planes into owned ones so they can be written to
+    void own() {
+        if (!borrowed_.owner) {
+            return;
+        }
+        std::size_t stride = aligned_stride(n_freq_);
+        re_.assign(stride * n_frames_, T(0));
+        im_.assign(stride * n_frames_, T(0));
+        for (uint32_t f = 0; f < n_frames_; f++) {
+            std::copy_n(borrowed_.re + f * stride_, n_freq_, re_.data() + f * stride);
+            std::copy_n(borrowed_.im + f * stride_, n_freq_, im_.data() + f * stride);
+        }
+        stride_ = stride;
+        borrowed_ = {};
+    }
+
+    void fill_cache() const {
+        std::lock_guard lock{cache_.mutex};
+        if (cache_.ready.load(std::memory_order_relaxed)) {
+            return; // another thread got here first
+        }
+        cache_.values.resize(re_.size());
+        T *out = cache_.values.data();
+        const T *re = re_.data(), *im = im_.data();
+        for (std::size_t i = 0; i < re_.size(); i++) {
+            out[i] = std::sqrt(re[i] * re[i] + im[i] * im[i]);
+        }
+        cache_.ready.store(true, std::memory_order_release);
+    }
+
+    uint32_t n_freq_;
+    uint32_t n_frames_;
+    std::size_t stride_;
+    std::vector<T> freqs_;
+    plane re_;
+    plane im_;
+    borrowed_planes borrowed_;
+    mutable amplitude_cache cache_;
+};
+
+}
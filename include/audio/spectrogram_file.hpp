@@ -0,0 +1,123 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+#include "audio/fourier.hpp"
+#include "audio/spectrogram.hpp"
+#include "audio/wave_data.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+/**
+ * start of a spectrogram file, which stores an stft_result so it can be mapped back in instead of recomputed
+ *
+ * after the header come the n_freq bin frequencies, then from frames_offset (a multiple of page_size) one record
+ * per frame: its real row, imaginary row and amplitude row, each row_size values long (n_freq rounded up to 64
+ * bytes, zero filled). the amplitudes are stored so a mapped spectrogram never has to touch the whole file to show
+ * part of it. everything is in the byte order of the machine that wrote it, a file from the other byte order fails
+ * the version check
+ */
+struct spectrogram_file_header {
+    static constexpr char expected_magic[8] = {'A', 'U', 'D', 'S', 'P', 'E', 'C', '\0'};
+    static constexpr uint32_t current_version = 1;
+    static constexpr uint64_t page_size = 4096;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t value_size; // sizeof the bins' type, 4 for float and 8 for double
+
+    uint32_t n_freq;
+    uint32_t n_signals;
+    uint32_t n_full_signals;
+    uint32_t samples_per_sec;
+    uint32_t n_samples;
+    uint32_t n_window_size;
+    uint32_t n_window_offset;
+    uint32_t window_type; // window_type as an integer
+    double window_param;
+    double freq_delta;
+    double time_delta;
+
+    uint64_t row_size; // values in a row, the frame records are 3 * row_size values apart
+    uint64_t freqs_offset; // in bytes from the start of the file
+    uint64_t frames_offset;
+};
+
+/**
+ * writes a spectrogram file one frame at a time, so an stft can be saved as it's computed (e.g. from an
+ * stft_stream's callback) without holding all of it in memory. nothing but the current frame is kept around
+ *
+ * the frame count and signal length go in the header once finish() is called, a file that never got finished
+ * can't be opened
+ */
+template <std::floating_point T = double>
+struct stft_file_writer {
+    /**
+     * creates (or replaces) path and writes everything but the frames
+     * @param freqs frequency of every bin, e.g. result.waves.freqs()
+     * the rest are what the transform was run with, as in stft_result
+     *
+     * throws std::runtime_error if the file can't be written
+     */
+    stft_file_writer(const std::filesystem::path &, std::vector<T> freqs, T freq_delta, uint32_t samples_per_sec,
+        uint32_t n_window_offset, uint32_t n_window_size, const window &win = {});
+
+    // appends a frame of n_freq() bins, as complex amplitudes split into real and imaginary parts
+    void write(const T *re, const T *im);
+    // appends a frame of n_freq() waves, the way stft_stream hands them out
+    void write(std::span<const wave_data> waves);
+
+    /**
+     * fills in the frame count and n_samples, the length of the signal the frames came from, and closes the file.
+     * frames that fit in n_samples count as n_full_signals like in naive_stft, the rest as zero padded tail frames
+     */
+    void finish(uint32_t n_samples);
+
+    uint32_t n_freq() const {
+        return header_.n_freq;
+    }
+    uint32_t n_frames() const {
+        return header_.n_signals;
+    }
+
+private:
+    std::ofstream file_;
+    spectrogram_file_header header_;
+    std::vector<T> record_; // the frame being written, in file layout
+};
+
+extern template struct stft_file_writer<float>;
+extern template struct stft_file_writer<double>;
+
+/**
+ * saves a whole stft_result to a spectrogram file, see stft_file_writer
+ * throws std::runtime_error if the file can't be written
+ */
+template <std::floating_point T>
+void write_stft_to_file(const std::filesystem::path &, const stft_result<T> &);
+
+/**
+ * opens a spectrogram file as an stft_result without reading it: the file is memory mapped and the result's waves
+ * borrow their planes from the mapping, so opening takes the same time for any size and only the pages that get
+ * looked at are ever read in. the mapping stays alive as long as the waves (or copies of them) do, writing to the
+ * waves copies them out of it first.
+ *
+ * T has to be the type the file was written with.
+ * throws std::runtime_error if the file can't be mapped, isn't a finished spectrogram file of this version, or
+ * holds the other precision
+ */
+template <std::floating_point T = double>
+stft_result<T> map_stft_from_file(const std::filesystem::path &);
+
+extern template void write_stft_to_file<float>(const std::filesystem::path &, const stft_result<float> &);
+extern template void write_stft_to_file<double>(const std::filesystem::path &, const stft_result<double> &);
+extern template stft_result<float> map_stft_from_file<float>(const std::filesystem::path &);
+extern template stft_result<double> map_stft_from_file<double>(const std::filesystem::path &);
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio/spectrogram.hpp"
+
+namespace audio {
+
+// how cells get combined when a view squeezes several into one pixel
+enum class pyramid_reduce {
+    max, // loudest amplitude, keeps short clicks and thin partials visible when zoomed out
+    mean, // average amplitude
+};
+
+struct spectrogram_pyramid_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    std::size_t tiles;
+    std::size_t bytes;
+    std::size_t capacity;
+};
+
+/**
+ * multi-resolution view of a spectrogram's amplitudes, for drawing it at any zoom in time proportional to the
+ * number of pixels instead of the number of bins
+ *
+ * level (t, f) has the spectrogram shrunk 2^t times along time and 2^f times along frequency, every cell holding
+ * the max and the mean amplitude of the 2^t by 2^f bins it covers. levels are cut into tile_size by tile_size tiles
+ * that are only built when a view needs them, from the two tiles under them at the next finer level (so building
+ * any tile costs O(tile_size²) once the finer ones exist), and kept in an lru cache bounded by capacity bytes,
+ * the same way table_cache works. level (0, 0) is the spectrogram itself: its cells are read straight from the
+ * spectrogram's amplitudes, so the cache only holds the levels that are actually shrunk.
+ *
+ * the spectrogram has to outlive the pyramid and not change while it's in use.
+ * everything is thread-safe, tiles get built without the cache locked
+ */
+template <typename T>
+struct spectrogram_pyramid {
+    static constexpr uint32_t tile_size = 64;
+    static constexpr std::size_t default_capacity = std::size_t(64) << 20;
+
+    // max and mean of the cells of one tile, cell (t, f) at t * tile_size + f. cells past the end are 0
+    struct tile {
+        std::vector<T> max;
+        std::vector<T> mean;
+    };
+
+    explicit spectrogram_pyramid(const spectrogram<T> &source, std::size_t capacity = default_capacity);
+    spectrogram_pyramid(const spectrogram_pyramid &) = delete;
+    spectrogram_pyramid &operator=(const spectrogram_pyramid &) = delete;
+
+    // number of levels along each axis, level n_time_levels() - 1 fits all frames in one cell
+    uint32_t n_time_levels() const {
+        return n_time_levels_;
+    }
+    uint32_t n_freq_levels() const {
+        return n_freq_levels_;
+    }
+
+    // tile (tile_t, tile_f) of level (level_t, level_f), built if it isn't cached.
+    // level (0, 0) tiles are copied out of the spectrogram on every call and never cached
+    std::shared_ptr<const tile> get(uint32_t level_t, uint32_t level_f, uint32_t tile_t, uint32_t tile_f);
+
+    /**
+     * draws frames [frame_begin, frame_end) and bins [bin_begin, bin_end) (fractional, so views can pan smoothly)
+     * into width by height pixels, out[y * width + x] with y = 0 the lowest frequency.
+     *
+     * uses the coarsest level with at most one cell per pixel, so each pixel combines at most 3 by 3 cells and the
+     * cost is O(width * height) plus whatever tiles aren't cached yet. parts of the view outside the spectrogram are 0
+     */
+    void render(double frame_begin, double frame_end, double bin_begin, double bin_end, uint32_t width,
+        uint32_t height, pyramid_reduce reduce, T *out);
+
+    spectrogram_pyramid_stats stats() const;
+    void set_capacity(std::size_t bytes); // evicts immediately if over the new capacity
+    void clear();
+
+private:
+    struct key {
+        uint32_t level_t, level_f, tile_t, tile_f;
+        auto operator<=>(const key &) const = default;
+    };
+    struct entry {
+        key k;
+        std::shared_ptr<const tile> value;
+    };
+
+    std::shared_ptr<const tile> build(const key &);
+    void evict(std::size_t capacity); // expects mutex_ to be held
+
+    const spectrogram<T> &source_;
+    uint32_t n_time_levels_;
+    uint32_t n_freq_levels_;
+
+    mutable std::mutex mutex_;
+    std::list<entry> lru_; // most recently used at the front
+    std::map<key, typename std::list<entry>::iterator> index_;
+    std::size_t bytes_;
+    std::size_t capacity_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+};
+
+extern template struct spectrogram_pyramid<float>;
+extern template struct spectrogram_pyramid<double>;
+
+}
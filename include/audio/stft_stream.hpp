@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "audio/fft.hpp"
+#include "audio/wave_data.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+/**
+ * incremental short-time fourier transform, for signals that don't fit in memory or haven't happened yet
+ *
+ * samples are pushed in as they come and every window that completes is transformed right away, giving the same
+ * frames as naive_stft over the whole signal, to rounding (naive_stft works amplitudes and phases out from its
+ * bins). only the last n_window_size samples are kept around, so memory use doesn't depend on how long the signal is
+ */
+struct stft_stream {
+    /**
+     * receives one frame of n_freq() waves
+     * index counts frames from 0, the frame starts at sample index * n_window_offset.
+     * the span is only valid during the call
+     */
+    using frame_fn = std::function<void(std::span<const wave_data> waves, uint64_t index)>;
+
+    /**
+     * parameters are the same as naive_stft's, except that n_window_size can't be 0 since there's no n_samples to
+     * default it from
+     */
+    stft_stream(uint32_t samples_per_sec, uint32_t n_window_offset, uint32_t n_window_size, const window &win = {});
+
+    /**
+     * adds n_samples samples to the stream, calling on_frame for every frame they complete, in order
+     * doesn't allocate, so this is fine to call from an audio callback if on_frame is
+     */
+    void push(uint32_t n_samples, const float *input, uint32_t in_spacing, const frame_fn &on_frame);
+
+    /**
+     * like the above, but completed frames are queued up to be taken with pop()
+     * the queue grows by one frame per n_window_offset samples pushed, so keep popping. popped frames are freed
+     * once they make up half the queue, so memory follows how far behind pop() is, not how long it's been running
+     */
+    void push(uint32_t n_samples, const float *input, uint32_t in_spacing);
+
+    /**
+     * moves the oldest queued frame into waves (resized to n_freq()), returns false if there aren't any
+     * index is set to the frame's index if given
+     */
+    bool pop(std::vector<wave_data> &waves, uint64_t *index = nullptr);
+
+    /**
+     * ends the stream like naive_stft with truncate = true, transforming the windows that start before the end of
+     * the signal but don't fit in it, zero padded to n_window_size like naive_stft's tail frames (a frame starting at
+     * sample o has n_samples() - o real samples). afterwards the stream starts over from sample 0,
+     * frames still queued for pop() stay there
+     */
+    void flush(const frame_fn &on_frame);
+
+    // starts over with no samples, dropping queued frames
+    void reset();
+
+    uint32_t n_freq() const { // n_window_size / 2 + 1, like naive_stft
+        return n_freq_;
+    }
+    uint64_t n_frames() const { // frames completed so far, queued or not
+        return n_frames_;
+    }
+    uint64_t n_samples() const { // samples pushed so far
+        return n_samples_;
+    }
+
+    double freq_delta() const {
+        return static_cast<double>(samples_per_sec_) / n_window_size_;
+    }
+    double time_delta() const {
+        return static_cast<double>(n_window_offset_) / samples_per_sec_;
+    }
+
+private:
+    void restart(); // forgets the samples, but not the queue
+    void emit(const frame_fn &on_frame);
+
+    uint32_t samples_per_sec_;
+    uint32_t n_window_offset_;
+    uint32_t n_window_size_;
+    uint32_t n_freq_;
+    window win_;
+    rfft_plan<double> plan_;
+    std::shared_ptr<const std::vector<double>> coefficients_; // null for a rectangular window
+    double amp_scale_;
+
+    // the last n_window_size samples, every sample is written twice (at pos and pos + n_window_size)
+    // so the window ending at pos_ is always contiguous
+    std::vector<float> ring_;
+    uint32_t pos_;
+    uint64_t n_samples_;
+    uint64_t n_frames_;
+    uint64_t next_end_; // sample count at which the next frame completes
+
+    std::vector<double> buffer_;
+    std::vector<wave_data> frame_;
+    std::vector<wave_data> queue_; // queued frames back to back, n_freq each
+    std::vector<uint64_t> queue_index_; // index of each queued frame
+    std::size_t queue_head_; // number of frames already popped off the front
+};
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace audio {
+
+// what a cached table holds, together with its size this decides what the contents are
+enum class table_kind : uint32_t {
+    fft_twiddles, // all stage twiddles of an fft_plan
+    bluestein_chirp, // e^(-πi k²/n)
+    bluestein_kernel, // transformed conjugate chirp
+    rfft_twiddles, // post-twiddles of an rfft_plan
+    dft_roots, // e^(-2πi k/n) for k in [0, n)
+    // window coefficients, param is the window's param
+    rectangular_window,
+    hann_window,
+    hamming_window,
+    blackman_harris_window,
+    kaiser_window,
+    flat_top_window,
+};
+
+struct table_key {
+    table_kind kind;
+    uint32_t n; // transform size
+    double param; // extra parameter for kinds that need one, 0 otherwise
+    uint32_t elem_size; // sizeof the element type, so float and double tables don't collide
+
+    auto operator<=>(const table_key &) const = default;
+};
+
+struct table_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    std::size_t entries;
+    std::size_t bytes; // bytes held by the cache itself, tables still in use elsewhere can outlive their entry
+    std::size_t capacity;
+};
+
+/**
+ * process-wide, thread-safe cache of precomputed tables (twiddle factors, window coefficients, ...) so plans of
+ * the same size share one copy of their trig instead of recomputing it
+ *
+ * memory is bounded by capacity() bytes, the least recently used tables get evicted first.
+ * tables are handed out as shared_ptrs, so evicting one never invalidates a plan that's using it
+ */
+struct table_cache {
+    static constexpr std::size_t default_capacity = std::size_t(64) << 20;
+
+    static table_cache &global();
+
+    explicit table_cache(std::size_t capacity = default_capacity);
+    table_cache(const table_cache &) = delete;
+    table_cache &operator=(const table_cache &) = delete;
+
+    /**
+     * returns the table for (kind, n, param), calling make() to build it on a miss
+     * make is called without the cache locked, so it may itself use the cache
+     */
+    template <typename T, typename F>
+    std::shared_ptr<const std::vector<T>> get(table_kind kind, uint32_t n, double param, F &&make) {
+        table_key key{kind, n, param, uint32_t(sizeof(T))};
+        if (auto found = find(key)) {
+            return std::static_pointer_cast<const std::vector<T>>(found);
+        }
+        auto table = std::make_shared<const std::vector<T>>(make());
+        return std::static_pointer_cast<const std::vector<T>>(insert(key, table, table->size() * sizeof(T)));
+    }
+
+    table_cache_stats stats() const;
+    std::size_t capacity() const;
+    void set_capacity(std::size_t bytes); // evicts immediately if over the new capacity
+    void clear();
+
+private:
+    struct entry {
+        table_key key;
+        std::shared_ptr<const void> table;
+        std::size_t bytes;
+    };
+
+    std::shared_ptr<const void> find(const table_key &);
+    std::shared_ptr<const void> insert(const table_key &, std::shared_ptr<const void>, std::size_t bytes);
+    void evict(std::size_t capacity); // expects mutex_ to be held
+
+    mutable std::mutex mutex_;
+    std::list<entry> lru_; // most recently used at the front
+    std::map<table_key, std::list<entry>::iterator> index_;
+    std::size_t bytes_;
+    std::size_t capacity_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+};
+
+}
\ No newline at end of file
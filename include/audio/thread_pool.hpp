@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audio {
+
+/**
+ * fixed set of worker threads for splitting loops across cores
+ *
+ * parallel_for cuts the range into chunks and deals them out evenly, when a worker runs out it steals the back half
+ * of whichever other worker still has the most left, so uneven chunks still finish at about the same time.
+ * the calling thread works too, so a pool of size() 1 has no extra threads at all
+ */
+struct thread_pool {
+    // callback for a range of indices [begin, end), worker is in [0, size()) and unique among concurrently running calls
+    using range_fn = std::function<void(std::size_t begin, std::size_t end, unsigned worker)>;
+
+    // n_threads is the total including the calling thread, 0 for std::thread::hardware_concurrency()
+    explicit thread_pool(unsigned n_threads = 0);
+    ~thread_pool();
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    unsigned size() const {
+        return unsigned(threads_.size()) + 1;
+    }
+
+    /**
+     * calls fn over [0, n) in chunks of at most grain indices and waits for all of them to finish
+     * exceptions thrown by fn are rethrown here (the first one wins)
+     *
+     * @param max_workers caps how many threads take part, 0 for all of them. with 1, everything runs in order
+     * on the calling thread
+     *
+     * calls from inside fn run serially on the calling worker instead of deadlocking
+     */
+    void parallel_for(std::size_t n, std::size_t grain, const range_fn &fn, unsigned max_workers = 0);
+
+    /**
+     * shared pool used by the transforms, sized by the AUDIO_THREADS environment variable
+     * or hardware_concurrency() if it isn't set
+     */
+    static thread_pool &global();
+
+private:
+    struct job;
+
+    void worker_loop(unsigned id);
+    static void run(job &, unsigned id);
+
+    std::vector<std::thread> threads_;
+    std::mutex submit_mutex_; // one parallel_for at a time
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    job *job_;
+    std::size_t generation_;
+    bool stop_;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <vector>
+
+namespace audio {
+
+enum class window_type {
+    rectangular,
+    hann,
+    hamming,
+    blackman_harris, // 4 term, -92 dB sidelobes
+    kaiser, // param is β
+    flat_top, // best amplitude accuracy, worst frequency resolution
+};
+
+const char *window_name(window_type);
+
+/**
+ * runtime description of a window function
+ * all windows are periodic (i.e. the length n + 1 symmetric window with the last sample dropped),
+ * which is what you want for spectral analysis
+ */
+struct window {
+    window_type type = window_type::rectangular;
+    double param = 0; // β for kaiser, unused by the others
+
+    auto operator<=>(const window &) const = default;
+};
+
+/**
+ * compile-time window policies, each with a constexpr value (the runtime window it represents)
+ * and coefficient(i, n) for the ith of n samples
+ */
+struct rectangular_window {
+    static constexpr window value{window_type::rectangular};
+    static double coefficient(uint32_t, uint32_t) {
+        return 1;
+    }
+};
+
+struct hann_window {
+    static constexpr window value{window_type::hann};
+    static double coefficient(uint32_t i, uint32_t n) {
+        return 0.5 - std::cos(2 * std::numbers::pi * i / n) / 2;
+    }
+};
+
+struct hamming_window {
+    static constexpr window value{window_type::hamming};
+    static double coefficient(uint32_t i, uint32_t n) {
+        return 0.54 - 0.46 * std::cos(2 * std::numbers::pi * i / n);
+    }
+};
+
+struct blackman_harris_window {
+    static constexpr window value{window_type::blackman_harris};
+    static double coefficient(uint32_t i, uint32_t n) {
+        double x = 2 * std::numbers::pi * i / n;
+        return 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+    }
+};
+
+double kaiser_coefficient(double beta, uint32_t i, uint32_t n);
+
+template <double Beta>
+struct kaiser_window {
+    static constexpr window value{window_type::kaiser, Beta};
+    static double coefficient(uint32_t i, uint32_t n) {
+        return kaiser_coefficient(Beta, i, n);
+    }
+};
+
+struct flat_top_window {
+    static constexpr window value{window_type::flat_top};
+    static double coefficient(uint32_t i, uint32_t n) {
+        double x = 2 * std::numbers::pi * i / n;
+        return 0.21557895 - 0.41663158 * std::cos(x) + 0.277263158 * std::cos(2 * x)
+            - 0.083578947 * std::cos(3 * x) + 0.006947368 * std::cos(4 * x);
+    }
+};
+
+template <typename W>
+concept window_policy = requires(uint32_t i) {
+    { W::value } -> std::convertible_to<window>;
+    { W::coefficient(i, i) } -> std::convertible_to<double>;
+};
+
+// coefficient of a runtime window, dispatches to the policies above
+double window_coefficient(const window &, uint32_t i, uint32_t n);
+
+/**
+ * the a_m of windows that are sums of cosines, w(i) = a_0 - a_1 cos(2πi/n) + a_2 cos(4πi/n) - ...
+ * which makes them easy to apply after the transform, as a weighted sum of neighbouring bins.
+ * empty for the windows that aren't (kaiser)
+ */
+std::vector<double> cosine_sum_terms(const window &);
+
+/**
+ * whether the squares of a window of n samples, repeated every offset samples, add up to a constant (within
+ * tolerance, relative to the constant). that's the constant overlap-add condition for analysing and resynthesizing
+ * with the same window, which is what istft does.
+ * e.g. hann passes at offsets of n / 4 (not n / 2, since it's squared), rectangular at any offset dividing n
+ */
+bool is_cola(const window &, uint32_t n, uint32_t offset, double tolerance = 1e-9);
+
+// builds the n coefficients of a window
+template <typename T>
+std::vector<T> make_window(const window &, uint32_t n);
+
+// like make_window, but shared through table_cache::global() so every transform of the same size reuses one table
+template <typename T>
+std::shared_ptr<const std::vector<T>> window_coefficients(const window &, uint32_t n);
+
+extern template std::vector<float> make_window<float>(const window &, uint32_t);
+extern template std::vector<double> make_window<double>(const window &, uint32_t);
+extern template std::shared_ptr<const std::vector<float>> window_coefficients<float>(const window &, uint32_t);
+extern template std::shared_ptr<const std::vector<double>> window_coefficients<double>(const window &, uint32_t);
+
+}
\ No newline at end of file
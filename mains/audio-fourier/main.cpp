@@ -64,12 +64,9 @@ int main() {
     SDL_RenderCopy(renderer, freq_texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
 
-    std::sort(squeak_fourier.begin(), squeak_fourier.end(),
-        [](const wave_data &a, const wave_data &b){
-            return a.amplitude > b.amplitude;
-        });
-    std::cout << "Top 30 waves:\n";
-    print_wave_data(std::vector(squeak_fourier.begin(), squeak_fourier.begin() + 30));
+    // peaks instead of a sort over every bin, with frequencies between the bins
+    std::cout << "Top 30 peaks:\n";
+    print_wave_data(find_peaks(squeak_fourier, 30));
     std::cout << "Out of " << squeak_fourier.size() << " waves.\n";
 
     std::cout << "Building reconstructions..." << std::endl;
@@ -96,8 +93,8 @@ int main() {
                 } else if (count < 1 || std::size_t(count) > squeak_fourier.size()) {
                     std::cout << "Invalid number of waves.\n";
                 } else {
-                    std::cout << "Playing with " << count << " highest..." << std::endl;
-                    auto squeak_ms_reconn = generate_monosignal(std::vector(squeak_fourier.begin(), squeak_fourier.begin() + count), squeak_ms.duration() * 2);
+                    std::cout << "Playing with " << count << " highest peaks..." << std::endl;
+                    auto squeak_ms_reconn = generate_monosignal(find_peaks(squeak_fourier, count), squeak_ms.duration() * 2);
                     squeak_ms_reconn.play();
                 }
             } catch (const std::invalid_argument &e) {
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <tuple>
@@ -15,33 +16,29 @@
 int width = 1600;
 int height = 900;
 
+// draws the part of an stft in view through its pyramid, so a zoomed out view costs one lookup per pixel instead
+// of a rectangle per bin
 template <typename T>
-void display_stft(const audio::stft_result<T> &result, SDL_Renderer *renderer, SDL_Texture *texture,
-    auto min_freq, auto max_freq, auto start_dur, auto end_dur) {
+void display_stft(const audio::stft_result<T> &result, audio::spectrogram_pyramid<T> &pyramid,
+    SDL_Renderer *renderer, SDL_Texture *texture, auto min_freq, auto max_freq, auto start_dur, auto end_dur) {
 
-    auto view_time_range = end_dur - start_dur;
-    auto view_freq_range = max_freq - min_freq;
-    auto data_w = static_cast<T>(width) * result.time_delta / view_time_range;
-    auto data_h = static_cast<T>(height) * result.freq_delta / view_freq_range;
+    auto base_freq = result.waves.freqs().empty() ? 0 : result.waves.freqs().front(); // nonzero for zoomed results
 
-    SDL_SetRenderTarget(renderer, texture);
+    // max so single loud bins don't fade away when zoomed out
+    std::vector<T> amplitudes(std::size_t(width) * height);
+    pyramid.render(start_dur / result.time_delta, end_dur / result.time_delta,
+        (min_freq - base_freq) / result.freq_delta, (max_freq - base_freq) / result.freq_delta,
+        width, height, audio::pyramid_reduce::max, amplitudes.data());
 
-    for (uint32_t s = start_dur / result.time_delta; s < std::ceil(end_dur / result.time_delta); s++) {
-        if (s * result.n_freq >= result.waves.size()) { // quick fix for something wrong with my math
-            break;
-        }
-        for (uint32_t f = min_freq / result.freq_delta; f < std::ceil(max_freq / result.freq_delta); f++) {
-            const auto &wave = result.waves[s * result.n_freq + f];
+    std::vector<uint32_t> pixels(amplitudes.size());
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
             // generally expect max amplitudes of 0.16 for regular signals (number i made up)
-            int col = std::min<T>(wave.amplitude * 6 * 255, 255);
-            SDL_SetRenderDrawColor(renderer, col, col, col, 255);
-            SDL_FRect rect{
-                float((s - start_dur / result.time_delta) * data_w),
-                float(height - (f - min_freq / result.freq_delta + 1) * data_h),
-                float(data_w), float(data_h)};
-            SDL_RenderFillRectF(renderer, &rect);
+            auto col = static_cast<uint32_t>(std::min<T>(amplitudes[std::size_t(y) * width + x] * 6 * 255, 255));
+            pixels[std::size_t(height - 1 - y) * width + x] = col | col << 8 | col << 16; // row 0 is the top
         }
     }
+    SDL_UpdateTexture(texture, nullptr, pixels.data(), width * sizeof(uint32_t));
 
     std::cout << "Renderered STFT result w/ " << min_freq << " - " << max_freq << " Hz freq range & "
         << start_dur << " - " << end_dur << " s time range\n"; 
@@ -53,6 +50,33 @@ void display_stft(const audio::stft_result<T> &result, SDL_Renderer *renderer, S
     SDL_RenderPresent(renderer);
 }
 
+// draws a constant-q result over the whole window, one row per bin from min_freq at the bottom
+template <typename T>
+void display_cqt(const audio::cqt_result<T> &result, SDL_Renderer *renderer, SDL_Texture *texture) {
+    SDL_SetRenderTarget(renderer, texture);
+
+    auto data_w = static_cast<float>(width) / result.n_signals;
+    auto data_h = static_cast<float>(height) / result.n_freq;
+    for (uint32_t s = 0; s < result.n_signals; s++) {
+        const T *amplitudes = result.waves.amplitudes(s);
+        for (uint32_t k = 0; k < result.n_freq; k++) {
+            int col = std::min<T>(amplitudes[k] * 6 * 255, 255); // same made up scale as display_stft
+            SDL_SetRenderDrawColor(renderer, col, col, col, 255);
+            SDL_FRect rect{s * data_w, height - (k + 1) * data_h, data_w, data_h};
+            SDL_RenderFillRectF(renderer, &rect);
+        }
+    }
+
+    std::cout << "Renderered CQT result w/ " << result.n_freq << " bins from " << result.min_freq << " - "
+        << result.max_freq << " Hz\n";
+
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_SetRenderDrawColor(renderer, 25, 0, 25, 255);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
+
 std::vector<std::string> split_string(const std::string &str) {
     std::vector<std::string> out;
     std::stringstream stream(str);
@@ -83,6 +107,7 @@ int main() {
     auto end = std::chrono::steady_clock::now();
     
     std::cout << "STFT computed in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << '\n';
+    auto pyramid = std::make_unique<spectrogram_pyramid<float>>(stft.waves);
 
     SDL_Window   *window   = SDL_CreateWindow("STFT Results", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, 0);
     SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
@@ -93,7 +118,7 @@ int main() {
     double min_freq, max_freq, start_dur, end_dur;
     
     std::cout << "Displaying STFT result...\n";
-    display_stft(stft, renderer, texture,
+    display_stft(stft, *pyramid, renderer, texture,
         min_freq = 0, max_freq = stft.freq_range,
         start_dur = 0, end_dur = stft.time_range);
 
@@ -132,7 +157,7 @@ int main() {
                     if (new_min_freq < 0 || new_max_freq > stft.freq_range || new_min_freq >= new_max_freq) {
                         std::cout << "Invalid range, attempted to set to " << new_min_freq << " Hz - " << new_max_freq << " Hz\n";
                     } else {
-                        display_stft(stft, renderer, texture,
+                        display_stft(stft, *pyramid, renderer, texture,
                             min_freq = new_min_freq, max_freq = new_max_freq,
                             start_dur, end_dur);
                     }
@@ -163,7 +188,7 @@ int main() {
                     if (new_min_dur < 0 || new_max_dur > stft.time_range || new_min_dur >= new_max_dur) {
                         std::cout << "Invalid range, attempted to set to " << new_min_dur << " s - " << new_max_dur << " s\n";
                     } else {
-                        display_stft(stft, renderer, texture,
+                        display_stft(stft, *pyramid, renderer, texture,
                             min_freq, max_freq,
                             start_dur = new_min_dur, end_dur = new_max_dur);
                     }
@@ -193,15 +218,102 @@ int main() {
                     auto end = std::chrono::steady_clock::now();
                     
                     std::cout << "STFT computed in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << '\n';
-                    display_stft(stft, renderer, texture,
+                    pyramid = std::make_unique<spectrogram_pyramid<float>>(stft.waves);
+                    display_stft(stft, *pyramid, renderer, texture,
                         min_freq = 0, max_freq = stft.freq_range,
                         start_dur = 0, end_dur = stft.time_range);
                 } catch (const std::runtime_error &e) {
                     std::cout << "Err while reading file: " << e.what() << '\n';
                 }
             }
+        } else if (words[0] == "save") {
+            if (words.size() != 2) {
+                std::cout << "Invalid arguments to save\n";
+            } else {
+                try {
+                    write_stft_to_file(words[1], stft);
+                    std::cout << "Saved STFT to " << words[1] << '\n';
+                } catch (const std::runtime_error &e) {
+                    std::cout << "Err while writing file: " << e.what() << '\n';
+                }
+            }
+        } else if (words[0] == "open") {
+            // maps a saved stft instead of recomputing it, zoom and cqt still work on the last loaded wav
+            if (words.size() != 2) {
+                std::cout << "Invalid arguments to open\n";
+            } else {
+                try {
+                    auto start = std::chrono::steady_clock::now();
+                    stft = map_stft_from_file<float>(words[1]);
+                    auto end = std::chrono::steady_clock::now();
+
+                    std::cout << "STFT opened in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << '\n';
+                    pyramid = std::make_unique<spectrogram_pyramid<float>>(stft.waves);
+                    display_stft(stft, *pyramid, renderer, texture,
+                        min_freq = 0, max_freq = stft.freq_range,
+                        start_dur = 0, end_dur = stft.time_range);
+                } catch (const std::runtime_error &e) {
+                    std::cout << "Err while opening file: " << e.what() << '\n';
+                }
+            }
+        } else if (words[0] == "partials") {
+            // tracks the loaded wav's partials on its own hann stft (the displayed one is rectangular, which peaks
+            // can't be interpolated on), saves them and plays them back
+            if (words.size() != 2) {
+                std::cout << "Invalid arguments to partials\n";
+            } else {
+                try {
+                    auto start = std::chrono::steady_clock::now();
+                    auto analysis = naive_stft<hann_window, float>(ms.data.size(), ms.data.data(), 1,
+                        ms.samples_per_sec, 256, true, 2048);
+                    auto partials = track_partials(analysis);
+                    auto end = std::chrono::steady_clock::now();
+
+                    std::cout << "Tracked " << partials.n_tracks << " partials (" << partials.points.size()
+                        << " points) in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << '\n';
+                    write_partials_to_file(words[1], partials);
+                    synthesize_partials(partials).play();
+                } catch (const std::runtime_error &e) {
+                    std::cout << "Err while writing file: " << e.what() << '\n';
+                }
+            }
+        } else if (words[0] == "zoom") {
+            if (words.size() != 3) {
+                std::cout << "Invalid arguments to zoom\n";
+            } else {
+                try {
+                    auto new_min_freq = std::stod(words[1]);
+                    auto new_max_freq = std::stod(words[2]);
+
+                    if (new_min_freq < 0 || new_max_freq > ms.samples_per_sec / 2. || new_min_freq >= new_max_freq) {
+                        std::cout << "Invalid range, attempted to zoom to " << new_min_freq << " Hz - " << new_max_freq << " Hz\n";
+                    } else {
+                        // recomputes just this band with one bin per pixel row, instead of cropping the stft
+                        auto start = std::chrono::steady_clock::now();
+                        auto zoomed = zoom_stft(ms.data.size(), ms.data.data(), 1, ms.samples_per_sec,
+                            window_offset, window_size, new_min_freq, new_max_freq, height);
+                        auto end = std::chrono::steady_clock::now();
+
+                        std::cout << "Zoomed STFT computed in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << '\n';
+                        spectrogram_pyramid zoomed_pyramid(zoomed.waves);
+                        display_stft(zoomed, zoomed_pyramid, renderer, texture,
+                            min_freq = new_min_freq, max_freq = new_max_freq,
+                            start_dur, end_dur);
+                    }
+                } catch (const std::invalid_argument &e) {
+                    std::cout << "Err: " << e.what() << '\n';
+                }
+            }
+        } else if (words[0] == "cqt") {
+            // piano range (A0 - C8) in semitones, "refresh" goes back to the stft
+            auto start = std::chrono::steady_clock::now();
+            auto result = cqt(ms.data.size(), ms.data.data(), 1, ms.samples_per_sec, window_offset, 27.5, 4186.01);
+            auto end = std::chrono::steady_clock::now();
+
+            std::cout << "CQT computed in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << '\n';
+            display_cqt(result, renderer, texture);
         } else if (words[0] == "refresh") {
-            display_stft(stft, renderer, texture,
+            display_stft(stft, *pyramid, renderer, texture,
                 min_freq, max_freq,
                 start_dur, end_dur);
         } else if (words[0] == "quit") {
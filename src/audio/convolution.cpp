@@ -0,0 +1,214 @@
+#include "audio/convolution.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "audio/simd.hpp"
+#include "audio/thread_pool.hpp"
+
+namespace audio {
+
+// impulse responses up to this many taps are faster to convolve directly than through ffts
+static constexpr uint32_t max_direct_taps = 64;
+
+// largest fft size overlap-save uses, the largest power of two a uint32_t holds
+static constexpr uint64_t max_overlap_save_size = uint64_t(1) << 31;
+
+// power of two fft size for overlap-save with an m tap ir over n_out outputs, the one with the least
+// n log n work per output sample, stopping once a single block covers everything
+static uint32_t overlap_save_size(uint32_t m, uint64_t n_out) {
+    if (std::bit_ceil(uint64_t(2) * m) > max_overlap_save_size) {
+        throw std::invalid_argument("convolve supports impulse responses of up to 2^30 taps");
+    }
+    uint64_t best = 0;
+    double best_cost = 0;
+    for (uint64_t size = std::bit_ceil(uint64_t(2) * m); size <= max_overlap_save_size; size *= 2) {
+        uint64_t step = size - m + 1;
+        double cost = double(size) * std::log2(double(size)) / double(std::min(step, n_out));
+        if (best == 0 || cost < best_cost) {
+            best = size;
+            best_cost = cost;
+        }
+        if (step >= n_out) {
+            break;
+        }
+    }
+    return uint32_t(best);
+}
+
+template <std::floating_point T>
+std::vector<float> convolve(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t n_ir,
+    const float *ir, uint32_t ir_spacing, uint32_t n_threads) {
+    if (n_samples == 0 || n_ir == 0) {
+        return {};
+    }
+    std::size_t n_out = std::size_t(n_samples) + n_ir - 1;
+    std::vector<float> out(n_out);
+    auto &pool = thread_pool::global();
+
+    if (n_ir <= max_direct_taps) {
+        std::vector<T> taps(n_ir);
+        for (uint32_t j = 0; j < n_ir; j++) {
+            taps[j] = ir[std::size_t(j) * ir_spacing];
+        }
+        constexpr std::size_t chunk = 4096;
+        pool.parallel_for((n_out + chunk - 1) / chunk, 4, [&](std::size_t begin, std::size_t end, unsigned) {
+            for (std::size_t n = begin * chunk; n < std::min(n_out, end * chunk); n++) {
+                // taps j with 0 <= n - j < n_samples
+                std::size_t first = n >= n_samples ? n - n_samples + 1 : 0, last = std::min<std::size_t>(n, n_ir - 1);
+                T sum = 0;
+                for (std::size_t j = first; j <= last; j++) {
+                    sum += taps[j] * static_cast<T>(input[(n - j) * in_spacing]);
+                }
+                out[n] = static_cast<float>(sum);
+            }
+        }, n_threads);
+        return out;
+    }
+
+    // overlap-save: block b makes outputs [b * step, (b + 1) * step) from the size inputs ending at the last of them,
+    // the first n_ir - 1 results of each circular convolution are wrapped around and thrown away
+    uint32_t size = overlap_save_size(n_ir, n_out);
+    uint32_t step = size - n_ir + 1;
+    uint32_t n_bins = size / 2 + 1;
+
+    rfft_plan<T> plan(size);
+    std::vector<std::complex<T>> response(n_bins + 1); // a spare bin so the transform can run in place
+    T *taps = reinterpret_cast<T *>(response.data());
+    std::fill(taps, taps + 2 * (n_bins + 1), T(0));
+    for (uint32_t j = 0; j < n_ir; j++) {
+        taps[j] = static_cast<T>(ir[std::size_t(j) * ir_spacing]) / size; // the inverse doesn't divide by size
+    }
+    plan.forward(taps, response.data());
+
+    std::vector<rfft_plan<T>> plans(pool.size(), plan);
+    std::vector<std::vector<std::complex<T>>> buffers(pool.size(), std::vector<std::complex<T>>(n_bins + 1));
+    std::size_t n_blocks = (n_out + step - 1) / step;
+    pool.parallel_for(n_blocks, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        auto &buffer = buffers[worker];
+        T *samples = reinterpret_cast<T *>(buffer.data());
+        for (std::size_t b = begin; b < end; b++) {
+            int64_t first = int64_t(b * step) - (n_ir - 1); // input index of samples[0]
+            for (uint32_t i = 0; i < size; i++) {
+                int64_t at = first + i;
+                samples[i] = at >= 0 && at < n_samples ? static_cast<T>(input[std::size_t(at) * in_spacing]) : T(0);
+            }
+
+            plans[worker].forward(samples, buffer.data());
+            simd::active<T>().twiddle_mul(n_bins, buffer.data(), response.data());
+            plans[worker].inverse(buffer.data(), samples);
+
+            std::size_t count = std::min<std::size_t>(step, n_out - b * step);
+            for (std::size_t i = 0; i < count; i++) {
+                out[b * step + i] = static_cast<float>(samples[n_ir - 1 + i]);
+            }
+        }
+    }, n_threads);
+
+    return out;
+}
+
+template <std::floating_point T>
+monosignal convolve(const monosignal &signal, const std::vector<float> &ir, uint32_t n_threads) {
+    return {signal.samples_per_sec, convolve<T>(uint32_t(signal.data.size()), signal.data.data(), 1,
+        uint32_t(ir.size()), ir.data(), 1, n_threads)};
+}
+
+template std::vector<float> convolve<float>(uint32_t, const float *, uint32_t, uint32_t, const float *, uint32_t,
+    uint32_t);
+template std::vector<float> convolve<double>(uint32_t, const float *, uint32_t, uint32_t, const float *, uint32_t,
+    uint32_t);
+template monosignal convolve<float>(const monosignal &, const std::vector<float> &, uint32_t);
+template monosignal convolve<double>(const monosignal &, const std::vector<float> &, uint32_t);
+
+static uint32_t checked_block_size(uint32_t block_size, uint32_t n_ir) {
+    if (block_size == 0 || n_ir == 0) {
+        throw std::invalid_argument("partitioned_convolver needs a nonzero block size and impulse response");
+    }
+    return block_size;
+}
+
+template <std::floating_point T>
+partitioned_convolver<T>::partitioned_convolver(uint32_t block_size, uint32_t n_ir, const float *ir,
+    uint32_t ir_spacing)
+    : block_size_{checked_block_size(block_size, n_ir)}, n_partitions_{(n_ir + block_size - 1) / block_size},
+      plan_(2 * block_size) {
+    uint32_t n_bins = block_size_ + 1;
+    partitions_.resize(std::size_t(n_partitions_) * n_bins);
+    history_.resize(std::size_t(n_partitions_) * n_bins);
+    sum_.resize(n_bins);
+    window_.resize(2 * std::size_t(block_size_));
+    input_.resize(block_size_);
+    output_.resize(block_size_);
+
+    // partition p holds taps [p * block_size, (p + 1) * block_size), zero padded to the fft size
+    std::vector<T> taps(2 * std::size_t(block_size_));
+    for (uint32_t p = 0; p < n_partitions_; p++) {
+        std::fill(taps.begin(), taps.end(), T(0));
+        for (uint32_t i = 0; i < block_size_ && p * block_size_ + i < n_ir; i++) {
+            taps[i] = static_cast<T>(ir[(std::size_t(p) * block_size_ + i) * ir_spacing]) / (2 * block_size_);
+        }
+        plan_.forward(taps.data(), partitions_.data() + std::size_t(p) * n_bins);
+    }
+    reset();
+}
+
+template <std::floating_point T>
+void partitioned_convolver<T>::reset() {
+    std::fill(history_.begin(), history_.end(), std::complex<T>(0));
+    std::fill(window_.begin(), window_.end(), T(0));
+    std::fill(output_.begin(), output_.end(), 0.f);
+    newest_ = 0;
+    pos_ = 0;
+}
+
+template <std::floating_point T>
+void partitioned_convolver<T>::process(uint32_t n, const float *input, float *output) {
+    for (uint32_t i = 0; i < n; i++) {
+        float sample = input[i]; // read first, output may be input
+        input_[pos_] = sample;
+        output[i] = output_[pos_];
+        if (++pos_ == block_size_) {
+            process_block();
+            pos_ = 0;
+        }
+    }
+}
+
+template <std::floating_point T>
+void partitioned_convolver<T>::process_block() {
+    uint32_t n_bins = block_size_ + 1;
+
+    // the window is the previous block followed by this one, its spectrum goes in the ring
+    std::copy(window_.begin() + block_size_, window_.end(), window_.begin());
+    std::copy(input_.begin(), input_.end(), window_.begin() + block_size_);
+    newest_ = newest_ + 1 == n_partitions_ ? 0 : newest_ + 1;
+    plan_.forward(window_.data(), history_.data() + std::size_t(newest_) * n_bins);
+
+    // partition p meets the block from p blocks ago
+    const auto &k = simd::active<T>();
+    std::fill(sum_.begin(), sum_.end(), std::complex<T>(0));
+    uint32_t slot = newest_;
+    for (uint32_t p = 0; p < n_partitions_; p++) {
+        k.complex_mac(n_bins, sum_.data(), history_.data() + std::size_t(slot) * n_bins,
+            partitions_.data() + std::size_t(p) * n_bins);
+        slot = slot == 0 ? n_partitions_ - 1 : slot - 1;
+    }
+
+    // the first half wrapped around, the second half is this block's output
+    T *result = reinterpret_cast<T *>(sum_.data());
+    plan_.inverse(sum_.data(), result);
+    for (uint32_t i = 0; i < block_size_; i++) {
+        output_[i] = static_cast<float>(result[block_size_ + i]);
+    }
+}
+
+template struct partitioned_convolver<float>;
+template struct partitioned_convolver<double>;
+
+}
@@ -0,0 +1,244 @@
+#include "audio/cqt.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+#include "audio/fft.hpp"
+#include "audio/thread_pool.hpp"
+
+namespace audio {
+
+namespace {
+
+// half-band low-pass for decimating by 2, a blackman windowed sinc with its cutoff at a quarter of the input rate.
+// it passes up to 0.2 of the input rate and stops from 0.3, so everything that aliases lands above 0.2 of the input
+// rate, which is above every bin the next octave looks at (max_freq <= 0.4 * samples_per_sec)
+constexpr int decimation_half_length = 31; // taps either side of the middle one
+
+// the taps at odd distances from the middle, the ones at even distances are 0 (except the middle, which is 1/2)
+const std::vector<double> &decimation_taps() {
+    static const std::vector<double> taps = []{
+        std::vector<double> taps;
+        double sum = 0;
+        for (int t = 1; t <= decimation_half_length; t += 2) {
+            double x = std::numbers::pi * t / decimation_half_length;
+            double w = 0.42 + 0.5 * std::cos(x) + 0.08 * std::cos(2 * x);
+            taps.push_back(std::sin(std::numbers::pi * t / 2) / (std::numbers::pi * t) * w);
+            sum += 2 * taps.back();
+        }
+        // unit gain at 0 Hz, so amplitudes don't drift a little more every octave
+        for (auto &tap : taps) {
+            tap *= 0.5 / sum;
+        }
+        return taps;
+    }();
+    return taps;
+}
+
+// low-passes x and keeps every other sample, output sample m lines up with input sample 2m (the filter is centered)
+std::vector<float> decimate(const std::vector<float> &x) {
+    const auto &taps = decimation_taps();
+    auto n = std::ptrdiff_t(x.size());
+    std::vector<float> y((x.size() + 1) / 2);
+    for (std::ptrdiff_t m = 0; m < std::ptrdiff_t(y.size()); m++) {
+        std::ptrdiff_t i = 2 * m;
+        double acc = 0.5 * x[i];
+        for (std::size_t j = 0; j < taps.size(); j++) {
+            std::ptrdiff_t t = 2 * std::ptrdiff_t(j) + 1;
+            double left = i - t >= 0 ? x[i - t] : 0.;
+            double right = i + t < n ? x[i + t] : 0.;
+            acc += taps[j] * (left + right);
+        }
+        y[m] = static_cast<float>(acc);
+    }
+    return y;
+}
+
+}
+
+template <std::floating_point T>
+cqt_plan<T>::cqt_plan(uint32_t samples_per_sec, double min_freq, double max_freq, uint32_t bins_per_octave,
+    const window &win, double q, double threshold)
+    : samples_per_sec_{samples_per_sec}, bins_per_octave_{bins_per_octave} {
+    if (bins_per_octave == 0 || !(q > 0)) {
+        throw std::invalid_argument("cqt_plan needs at least one bin per octave and a positive q");
+    }
+    if (!(min_freq > 0) || max_freq < min_freq || max_freq > 0.4 * samples_per_sec) {
+        throw std::invalid_argument("cqt_plan frequencies have to satisfy 0 < min_freq <= max_freq <= 0.4 * samples_per_sec");
+    }
+
+    n_freq_ = uint32_t(std::floor(bins_per_octave * std::log2(max_freq / min_freq) + 1e-9)) + 1;
+    n_octaves_ = (n_freq_ + bins_per_octave - 1) / bins_per_octave;
+    freqs_.resize(n_freq_);
+    for (uint32_t k = 0; k < n_freq_; k++) {
+        freqs_[k] = static_cast<T>(min_freq * std::exp2(double(k) / bins_per_octave));
+    }
+
+    // the kernel covers the top octave, or everything if there's less than an octave
+    uint32_t n_rows = std::min(bins_per_octave, n_freq_);
+    uint32_t top = n_freq_ - n_rows;
+    double bandwidth_ratio = std::exp2(1. / bins_per_octave) - 1;
+    auto atom_length = [&](double freq) {
+        return std::max<uint32_t>(1, uint32_t(std::ceil(q * samples_per_sec / (freq * bandwidth_ratio))));
+    };
+
+    // the lowest row has the longest window
+    fft_size_ = 1;
+    while (fft_size_ < atom_length(min_freq * std::exp2(double(top) / bins_per_octave))) {
+        fft_size_ *= 2;
+    }
+
+    auto k = std::make_shared<kernel>();
+    fft_plan<double> plan(fft_size_);
+    std::vector<std::complex<double>> atom(fft_size_);
+    k->offset.push_back(0);
+    for (uint32_t r = 0; r < n_rows; r++) {
+        double freq = min_freq * std::exp2(double(top + r) / bins_per_octave);
+        uint32_t length = atom_length(freq);
+        auto coefficients = make_window<double>(win, length);
+        double sum = 0;
+        for (auto c : coefficients) {
+            sum += c;
+        }
+
+        // the window's exponential, centered in the fft and with phase 0 at the center so the coefficients come out
+        // with the phases at the middle of the frame. scaled by 2 / sum like naive_ft's amplitudes
+        std::fill(atom.begin(), atom.end(), 0.);
+        uint32_t start = (fft_size_ - length) / 2;
+        for (uint32_t i = 0; i < length; i++) {
+            double revs = freq * (double(start + i) - fft_size_ / 2.) / samples_per_sec;
+            atom[start + i] = std::polar(coefficients[i] * 2 / sum, 2 * std::numbers::pi * revs);
+        }
+        plan.forward(atom.data(), atom.data());
+
+        // by parseval, sum x conj(atom) = sum X conj(A) / n. the atom is (nearly) analytic, so only the
+        // positive frequencies matter, and of those only the few around freq are above the threshold
+        uint32_t n_half = fft_size_ / 2 + 1;
+        double peak = 0;
+        for (uint32_t j = 0; j < n_half; j++) {
+            peak = std::max(peak, std::abs(atom[j]));
+        }
+        uint32_t first = 0, last = n_half - 1;
+        while (first < last && std::abs(atom[first]) < threshold * peak) {
+            first++;
+        }
+        while (last > first && std::abs(atom[last]) < threshold * peak) {
+            last--;
+        }
+        k->first.push_back(first);
+        for (uint32_t j = first; j <= last; j++) {
+            k->values.push_back(std::complex<T>(std::conj(atom[j]) / double(fft_size_)));
+        }
+        k->offset.push_back(uint32_t(k->values.size()));
+        k->top_freqs.push_back(static_cast<T>(freq));
+    }
+    kernel_ = std::move(k);
+}
+
+template <std::floating_point T>
+cqt_result<T> cqt_plan<T>::transform(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t n_window_offset, uint32_t n_threads) const {
+    if (n_window_offset == 0) {
+        throw std::invalid_argument("cqt needs a nonzero window offset");
+    }
+    uint32_t n_frames = n_samples == 0 ? 0 : (n_samples - 1) / n_window_offset + 1;
+
+    // octave o runs on the signal decimated o times
+    std::vector<std::vector<float>> levels(n_octaves_);
+    levels[0].resize(n_samples);
+    for (uint32_t i = 0; i < n_samples; i++) {
+        levels[0][i] = input[std::size_t(i) * in_spacing];
+    }
+    for (uint32_t o = 1; o < n_octaves_; o++) {
+        levels[o] = decimate(levels[o - 1]);
+    }
+
+    spectrogram<T> waves(freqs_, n_frames);
+    const kernel &k = *kernel_;
+    auto n_rows = uint32_t(k.first.size());
+    uint32_t top = n_freq_ - n_rows;
+
+    auto &pool = thread_pool::global();
+    std::vector<rfft_plan<T>> plans(pool.size(), rfft_plan<T>(fft_size_));
+    std::vector<std::vector<T>> buffers(pool.size(), std::vector<T>(fft_size_ + 2));
+
+    pool.parallel_for(n_frames, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        auto &buffer = buffers[worker];
+        auto bins = reinterpret_cast<std::complex<T> *>(buffer.data());
+        for (std::size_t s = begin; s < end; s++) {
+            T *re = waves.mutable_re(uint32_t(s)), *im = waves.mutable_im(uint32_t(s));
+            double center = double(s) * n_window_offset;
+            for (uint32_t o = 0; o < n_octaves_; o++) {
+                // the frame's center rounded to this octave's samples
+                const auto &x = levels[o];
+                double factor = std::exp2(o);
+                auto middle = std::llround(center / factor);
+                auto first = std::ptrdiff_t(middle) - std::ptrdiff_t(fft_size_ / 2);
+                for (uint32_t i = 0; i < fft_size_; i++) {
+                    auto at = first + std::ptrdiff_t(i);
+                    buffer[i] = at >= 0 && at < std::ptrdiff_t(x.size()) ? static_cast<T>(x[at]) : T(0);
+                }
+                plans[worker].forward(buffer.data(), bins);
+
+                // the coefficients have the phases at the rounded center, rotate them back to the real one
+                double shift = double(middle) * factor - center;
+                for (uint32_t r = 0; r < n_rows; r++) {
+                    if (top + r < o * bins_per_octave_) {
+                        continue; // below min_freq in the lowest octave
+                    }
+                    uint32_t bin = top + r - o * bins_per_octave_;
+                    const std::complex<T> *values = k.values.data() + k.offset[r];
+                    const std::complex<T> *from = bins + k.first[r];
+                    std::complex<T> sum = 0;
+                    for (uint32_t j = 0; j < k.offset[r + 1] - k.offset[r]; j++) {
+                        sum += values[j] * from[j];
+                    }
+                    if (shift != 0) {
+                        sum *= std::polar<T>(1, static_cast<T>(-2 * std::numbers::pi * freqs_[bin] * shift
+                            / samples_per_sec_));
+                    }
+                    re[bin] = sum.real();
+                    im[bin] = sum.imag();
+                }
+            }
+        }
+    }, n_threads);
+
+    return {
+        std::move(waves),
+        n_freq_,
+        n_frames,
+        bins_per_octave_,
+        freqs_.front(),
+        freqs_.back(),
+        static_cast<T>(n_window_offset) / samples_per_sec_, // time_delta
+        static_cast<T>(n_window_offset) / samples_per_sec_ * n_frames, // time_range
+        samples_per_sec_,
+        n_samples,
+        n_window_offset
+    };
+}
+
+template struct cqt_plan<float>;
+template struct cqt_plan<double>;
+
+template <std::floating_point T>
+cqt_result<T> cqt(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec,
+    uint32_t n_window_offset, double min_freq, double max_freq, uint32_t bins_per_octave, const window &win,
+    uint32_t n_threads) {
+    return cqt_plan<T>(samples_per_sec, min_freq, max_freq, bins_per_octave, win)
+        .transform(n_samples, input, in_spacing, n_window_offset, n_threads);
+}
+
+template cqt_result<float> cqt<float>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, double, double, uint32_t,
+    const window &, uint32_t);
+template cqt_result<double> cqt<double>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, double, double,
+    uint32_t, const window &, uint32_t);
+
+}
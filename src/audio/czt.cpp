@@ -0,0 +1,192 @@
+#include "audio/czt.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "audio/simd.hpp"
+#include "audio/thread_pool.hpp"
+
+namespace audio {
+
+// fractional part of a * b, with the rounding error of the product added back so it stays accurate when a * b is
+// huge (a * n² for n in the millions)
+static double frac_product(double a, double b) {
+    double p = a * b;
+    double error = std::fma(a, b, -p);
+    return p - std::floor(p) + error;
+}
+
+static uint32_t checked_size(uint32_t n_samples, uint32_t n_bins) {
+    if (n_samples == 0 || n_bins == 0) {
+        throw std::invalid_argument("czt_plan needs at least one sample and one bin");
+    }
+    // the convolution has to hold n_samples + n_bins - 1 points without wrapping around
+    uint32_t size = 1;
+    while (size < n_samples + n_bins - 1) {
+        size *= 2;
+    }
+    return size;
+}
+
+template <std::floating_point T>
+czt_plan<T>::czt_plan(uint32_t n_samples, uint32_t samples_per_sec, double min_freq, double max_freq,
+    uint32_t n_bins, const window &win)
+    : n_{n_samples}, m_{n_bins}, plan_(checked_size(n_samples, n_bins)) {
+    if (!(min_freq >= 0) || max_freq < min_freq || max_freq > samples_per_sec / 2.) {
+        throw std::invalid_argument("czt_plan frequencies have to satisfy 0 <= min_freq <= max_freq <= samples_per_sec / 2");
+    }
+
+    double step = n_bins > 1 ? (max_freq - min_freq) / (n_bins - 1) : 0.;
+    double half_r = step / samples_per_sec / 2; // chirps are e^(±2πi half_r k²)
+    double start = min_freq / samples_per_sec;
+    uint32_t size = plan_.size();
+    const double tau = 2 * std::numbers::pi;
+
+    freqs_.resize(m_);
+    for (uint32_t m = 0; m < m_; m++) {
+        freqs_[m] = static_cast<T>(min_freq + m * step);
+    }
+
+    // same coherent gain correction as naive_ft
+    auto coefficients = make_window<double>(win, n_);
+    double sum = 0;
+    for (auto c : coefficients) {
+        sum += c;
+    }
+    double amp_scale = 2 / sum;
+
+    auto pre = std::make_shared<std::vector<std::complex<T>>>(n_);
+    for (uint32_t i = 0; i < n_; i++) {
+        double revs = frac_product(start, i) + frac_product(half_r, double(i) * i);
+        (*pre)[i] = std::complex<T>(std::polar(coefficients[i] * amp_scale, -tau * revs));
+    }
+
+    // the chirp is needed at lags -(n - 1) to m - 1, negative ones wrap around to the end
+    std::vector<std::complex<T>> chirp(size);
+    for (uint32_t k = 0; k < std::max(n_, m_); k++) {
+        auto z = std::complex<T>(std::polar(1. / size, tau * frac_product(half_r, double(k) * k)));
+        if (k < m_) {
+            chirp[k] = z;
+        }
+        if (k > 0 && k < n_) {
+            chirp[size - k] = z;
+        }
+    }
+    plan_.forward(chirp.data(), chirp.data());
+
+    auto post = std::make_shared<std::vector<std::complex<T>>>(m_);
+    for (uint32_t m = 0; m < m_; m++) {
+        (*post)[m] = std::complex<T>(std::polar(1., -tau * frac_product(half_r, double(m) * m)));
+        // same as naive_stft's 0 Hz and, for even sizes, nyquist, which don't have a negative twin
+        double freq = min_freq + m * step;
+        bool nyquist = n_ % 2 == 0 && std::abs(freq - samples_per_sec / 2.) <= 1e-9 * samples_per_sec;
+        if (freqs_[m] == 0 || nyquist) {
+            (*post)[m] /= 2;
+        }
+    }
+
+    pre_ = std::move(pre);
+    kernel_ = std::make_shared<const std::vector<std::complex<T>>>(std::move(chirp));
+    post_ = std::move(post);
+    scratch_.resize(size);
+}
+
+template <std::floating_point T>
+void czt_plan<T>::transform(const float *input, uint32_t in_spacing, std::complex<T> *out) {
+    const auto &pre = *pre_;
+    for (uint32_t i = 0; i < n_; i++) {
+        scratch_[i] = static_cast<T>(input[std::size_t(i) * in_spacing]) * pre[i];
+    }
+    std::fill(scratch_.begin() + n_, scratch_.end(), std::complex<T>(0));
+
+    plan_.forward(scratch_.data(), scratch_.data());
+    simd::active<T>().twiddle_mul(scratch_.size(), scratch_.data(), kernel_->data());
+    plan_.inverse(scratch_.data(), scratch_.data());
+
+    const auto &post = *post_;
+    for (uint32_t m = 0; m < m_; m++) {
+        out[m] = scratch_[m] * post[m];
+    }
+}
+
+template <std::floating_point T>
+std::vector<wave_data_t<T>> czt_plan<T>::waves(const float *input, uint32_t in_spacing) {
+    std::vector<std::complex<T>> bins(m_);
+    transform(input, in_spacing, bins.data());
+    std::vector<wave_data_t<T>> waves(m_);
+    for (uint32_t m = 0; m < m_; m++) {
+        waves[m] = {freqs_[m], std::abs(bins[m]), std::arg(bins[m])};
+    }
+    return waves;
+}
+
+template struct czt_plan<float>;
+template struct czt_plan<double>;
+
+template <std::floating_point T>
+std::vector<wave_data_t<T>> zoom_ft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, double min_freq, double max_freq, uint32_t n_bins, const window &win) {
+    return czt_plan<T>(n_samples, samples_per_sec, min_freq, max_freq, n_bins, win).waves(input, in_spacing);
+}
+
+template <std::floating_point T>
+stft_result<T> zoom_stft(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec,
+    uint32_t n_window_offset, uint32_t n_window_size, double min_freq, double max_freq, uint32_t n_bins,
+    const window &win, uint32_t n_threads) {
+    if (n_window_size == 0) {
+        n_window_size = n_samples / n_window_offset;
+    }
+    czt_plan<T> plan(n_window_size, samples_per_sec, min_freq, max_freq, n_bins, win);
+    uint32_t n_signals = n_window_size > n_samples ? 0 : (n_samples - n_window_size) / n_window_offset + 1;
+    spectrogram<T> waves(plan.freqs(), n_signals);
+
+    // like naive_stft, a plan copy per worker, so the frames come out the same for any thread count
+    auto &pool = thread_pool::global();
+    std::vector<czt_plan<T>> plans(pool.size(), plan);
+    std::vector<std::vector<std::complex<T>>> bins(pool.size(), std::vector<std::complex<T>>(n_bins));
+    pool.parallel_for(n_signals, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        for (std::size_t s = begin; s < end; s++) {
+            plans[worker].transform(input + s * n_window_offset * in_spacing, in_spacing, bins[worker].data());
+            T *re = waves.mutable_re(uint32_t(s)), *im = waves.mutable_im(uint32_t(s));
+            for (uint32_t m = 0; m < n_bins; m++) {
+                re[m] = bins[worker][m].real();
+                im[m] = bins[worker][m].imag();
+            }
+        }
+    }, n_threads);
+
+    T freq_delta = n_bins > 1 ? static_cast<T>((max_freq - min_freq) / (n_bins - 1)) : T(0);
+    return {
+        std::move(waves),
+        n_bins,
+        n_signals,
+        freq_delta,
+        freq_delta * n_bins, // freq_range
+        static_cast<T>(n_window_offset) / samples_per_sec, // time_delta
+        static_cast<T>(n_window_offset) / samples_per_sec * n_signals, // time_range
+        n_signals, // n_full_signals
+        samples_per_sec,
+        n_samples,
+        n_window_size,
+        n_window_offset,
+        win
+    };
+}
+
+template std::vector<wave_data> zoom_ft<double>(uint32_t, const float *, uint32_t, uint32_t, double, double,
+    uint32_t, const window &);
+template std::vector<wave_dataf> zoom_ft<float>(uint32_t, const float *, uint32_t, uint32_t, double, double,
+    uint32_t, const window &);
+template stft_result<double> zoom_stft<double>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, uint32_t,
+    double, double, uint32_t, const window &, uint32_t);
+template stft_result<float> zoom_stft<float>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, uint32_t,
+    double, double, uint32_t, const window &, uint32_t);
+
+}
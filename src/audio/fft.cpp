@@ -0,0 +1,328 @@
+#include "audio/fft.hpp"
+
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+namespace audio {
+
+// e^(-2πi num/den), computed in double so float plans don't lose accuracy in the table
+static std::complex<double> root(uint64_t num, uint64_t den) {
+    return std::polar(1., -2 * std::numbers::pi * static_cast<double>(num % den) / static_cast<double>(den));
+}
+
+static bool is_smooth(uint32_t n) {
+    for (uint32_t p : {2, 3, 5}) {
+        while (n % p == 0) {
+            n /= p;
+        }
+    }
+    return n == 1;
+}
+
+template <typename T>
+fft_plan<T>::fft_plan(uint32_t n) : n_{n}, kernels_{&simd::active<T>()} {
+    // factor n, outermost stage first. radix 4 is just two radix 2 stages fused together
+    std::vector<uint32_t> radices;
+    uint32_t rem = n;
+    while (rem > 1 && rem % 4 == 0) {
+        radices.push_back(4);
+        rem /= 4;
+    }
+    for (uint32_t p = 2; p <= max_radix && rem > 1; p++) {
+        while (rem % p == 0) {
+            radices.push_back(p);
+            rem /= p;
+        }
+    }
+
+    auto &cache = table_cache::global();
+    if (rem > 1) {
+        // prime factor too big for a direct butterfly, do the chirp-z trick with a smooth inner size >= 2n - 1
+        uint32_t m = 2 * n - 1;
+        while (!is_smooth(m)) {
+            m++;
+        }
+        inner_ = std::make_unique<fft_plan>(m);
+
+        chirp_ = cache.get<std::complex<T>>(table_kind::bluestein_chirp, n, 0, [n]{
+            std::vector<std::complex<T>> chirp(n);
+            for (uint32_t k = 0; k < n; k++) {
+                // e^(-πi k²/n) = e^(-2πi k²/2n), with k² reduced mod 2n to keep the angle small
+                chirp[k] = std::complex<T>(root(uint64_t(k) * k % (2 * uint64_t(n)), 2 * uint64_t(n)));
+            }
+            return chirp;
+        });
+
+        kernel_ = cache.get<std::complex<T>>(table_kind::bluestein_kernel, n, 0, [&]{
+            const auto &chirp = *chirp_;
+            std::vector<std::complex<T>> kernel(m, 0);
+            kernel[0] = std::conj(chirp[0]);
+            for (uint32_t k = 1; k < n; k++) {
+                kernel[k] = kernel[m - k] = std::conj(chirp[k]);
+            }
+            inner_->forward(kernel.data(), kernel.data());
+            for (auto &k : kernel) {
+                k /= static_cast<T>(m);
+            }
+            return kernel;
+        });
+
+        scratch_.resize(m);
+        return;
+    }
+
+    uint32_t sub_n = n;
+    std::size_t n_twiddles = 0;
+    for (uint32_t p : radices) {
+        uint32_t m = sub_n / p;
+        stages_.push_back({p, m, n_twiddles});
+        n_twiddles += (p - 1) * m;
+        if (p != 2 && p != 3 && p != 4 && p != 5) {
+            n_twiddles += p;
+        }
+        sub_n = m;
+    }
+
+    twiddles_ = cache.get<std::complex<T>>(table_kind::fft_twiddles, n, 0, [&]{
+        std::vector<std::complex<T>> twiddles;
+        twiddles.reserve(n_twiddles);
+        for (const auto &[p, m, twiddle_offset] : stages_) {
+            for (uint32_t q = 1; q < p; q++) {
+                for (uint32_t k = 0; k < m; k++) {
+                    twiddles.emplace_back(root(uint64_t(q) * k, uint64_t(p) * m));
+                }
+            }
+            if (p != 2 && p != 3 && p != 4 && p != 5) {
+                for (uint32_t j = 0; j < p; j++) {
+                    twiddles.emplace_back(root(j, p));
+                }
+            }
+        }
+        return twiddles;
+    });
+
+    scratch_.resize(n);
+}
+
+template <typename T>
+fft_plan<T>::fft_plan(const fft_plan &other) :
+        n_{other.n_}, kernels_{other.kernels_}, stages_{other.stages_}, twiddles_{other.twiddles_},
+        chirp_{other.chirp_}, kernel_{other.kernel_},
+        inner_{other.inner_ ? std::make_unique<fft_plan>(*other.inner_) : nullptr},
+        scratch_(other.scratch_.size()) {}
+
+template <typename T>
+fft_plan<T> &fft_plan<T>::operator=(fft_plan other) {
+    std::swap(n_, other.n_);
+    std::swap(kernels_, other.kernels_);
+    std::swap(stages_, other.stages_);
+    std::swap(twiddles_, other.twiddles_);
+    std::swap(chirp_, other.chirp_);
+    std::swap(kernel_, other.kernel_);
+    std::swap(inner_, other.inner_);
+    std::swap(scratch_, other.scratch_);
+    return *this;
+}
+
+template <typename T>
+void fft_plan<T>::forward(const std::complex<T> *input, std::complex<T> *output) {
+    if (n_ <= 1) {
+        std::copy(input, input + n_, output);
+        return;
+    }
+    if (inner_) {
+        bluestein(input, output, false);
+        return;
+    }
+    if (input == output) {
+        std::copy(input, input + n_, scratch_.begin());
+        input = scratch_.data();
+    }
+    transform(output, input, 1, 0);
+}
+
+template <typename T>
+void fft_plan<T>::inverse(const std::complex<T> *input, std::complex<T> *output) {
+    // ifft(x) = conj(fft(conj(x)))
+    if (n_ <= 1) {
+        std::copy(input, input + n_, output);
+        return;
+    }
+    if (inner_) {
+        bluestein(input, output, true);
+    } else {
+        std::transform(input, input + n_, scratch_.begin(), [](const auto &c){ return std::conj(c); });
+        transform(output, scratch_.data(), 1, 0);
+    }
+    for (uint32_t i = 0; i < n_; i++) {
+        output[i] = std::conj(output[i]);
+    }
+}
+
+// recursive decimation in time, leaves the sub-transforms of each residue class in consecutive rows of output
+// and then combines the rows in place
+template <typename T>
+void fft_plan<T>::transform(std::complex<T> *output, const std::complex<T> *input, std::size_t stride, std::size_t s) {
+    const auto [p, m, twiddle_offset] = stages_[s];
+
+    if (m == 1) {
+        for (uint32_t q = 0; q < p; q++) {
+            output[q] = input[q * stride];
+        }
+    } else {
+        for (uint32_t q = 0; q < p; q++) {
+            transform(output + q * m, input + q * stride, stride * p, s + 1);
+        }
+
+        const std::complex<T> *tw = twiddles_->data() + twiddle_offset;
+        for (uint32_t q = 1; q < p; q++) {
+            // k = 0 always has a twiddle of 1
+            kernels_->twiddle_mul(m - 1, output + q * m + 1, tw + (q - 1) * m + 1);
+        }
+    }
+
+    if (p == 2) {
+        kernels_->butterfly2(m, output);
+    } else if (p == 4) {
+        kernels_->butterfly4(m, output);
+    } else if (p == 3) {
+        kernels_->butterfly3(m, output);
+    } else if (p == 5) {
+        kernels_->butterfly5(m, output);
+    } else {
+        const std::complex<T> *roots = twiddles_->data() + twiddle_offset + (p - 1) * m;
+        std::array<std::complex<T>, max_radix> in;
+        for (uint32_t k = 0; k < m; k++) {
+            for (uint32_t q = 0; q < p; q++) {
+                in[q] = output[q * m + k];
+            }
+            for (uint32_t t = 0; t < p; t++) {
+                std::complex<T> sum = in[0];
+                for (uint32_t q = 1, j = t; q < p; q++, j = (j + t) % p) {
+                    sum += in[q] * roots[j];
+                }
+                output[t * m + k] = sum;
+            }
+        }
+    }
+}
+
+// X[k] = w[k] sum_i (x[i] w[i]) conj(w[k - i]) with w[k] = e^(-πi k²/n), which is a convolution we can do with ffts
+template <typename T>
+void fft_plan<T>::bluestein(const std::complex<T> *input, std::complex<T> *output, bool conj_input) {
+    uint32_t m = inner_->size();
+    std::fill(scratch_.begin() + n_, scratch_.end(), 0);
+    for (uint32_t k = 0; k < n_; k++) {
+        scratch_[k] = (conj_input ? std::conj(input[k]) : input[k]) * (*chirp_)[k];
+    }
+
+    inner_->forward(scratch_.data(), scratch_.data());
+    // inverse transform of the product, done as conj(fft(conj(...)))
+    kernels_->twiddle_mul(m, scratch_.data(), kernel_->data());
+    for (uint32_t k = 0; k < m; k++) {
+        scratch_[k] = std::conj(scratch_[k]);
+    }
+    inner_->forward(scratch_.data(), scratch_.data());
+
+    for (uint32_t k = 0; k < n_; k++) {
+        output[k] = std::conj(scratch_[k]) * (*chirp_)[k];
+    }
+}
+
+template struct fft_plan<float>;
+template struct fft_plan<double>;
+
+template <typename T>
+rfft_plan<T>::rfft_plan(uint32_t n) : n_{n}, half_(n % 2 ? n : n / 2) {
+    if (n % 2) {
+        scratch_.resize(n);
+        return;
+    }
+
+    twiddles_ = table_cache::global().get<std::complex<T>>(table_kind::rfft_twiddles, n, 0, [n]{
+        std::vector<std::complex<T>> twiddles;
+        twiddles.reserve(n / 4 + 1);
+        for (uint32_t k = 0; k <= n / 4; k++) {
+            twiddles.emplace_back(root(k, n));
+        }
+        return twiddles;
+    });
+}
+
+template <typename T>
+void rfft_plan<T>::forward(const T *input, std::complex<T> *output) {
+    if (n_ % 2) {
+        for (uint32_t i = 0; i < n_; i++) {
+            scratch_[i] = input[i];
+        }
+        half_.forward(scratch_.data(), scratch_.data());
+        std::copy(scratch_.begin(), scratch_.begin() + n_bins(), output);
+        return;
+    }
+
+    // z[i] = x[2i] + i x[2i + 1], std::complex is guaranteed to be laid out as two Ts
+    uint32_t h = n_ / 2;
+    half_.forward(reinterpret_cast<const std::complex<T> *>(input), output);
+
+    // with E and O the transforms of the even and odd samples,
+    // E[k] = (Z[k] + conj(Z[h - k])) / 2, O[k] = -i (Z[k] - conj(Z[h - k])) / 2
+    // X[k] = E[k] + w^k O[k] and X[h - k] = conj(E[k] - w^k O[k])
+    const std::complex<T> *tw = twiddles_->data();
+    auto z0 = output[0];
+    output[0] = z0.real() + z0.imag();
+    output[h] = z0.real() - z0.imag();
+    for (uint32_t k = 1; k <= h / 2; k++) {
+        auto zk = output[k], zc = std::conj(output[h - k]);
+        auto even = (zk + zc) * T(0.5);
+        auto diff = (zk - zc) * T(0.5);
+        auto odd = tw[k] * std::complex<T>(diff.imag(), -diff.real());
+        output[k] = even + odd;
+        output[h - k] = std::conj(even - odd);
+    }
+}
+
+template <typename T>
+void rfft_plan<T>::inverse(const std::complex<T> *input, T *output) {
+    if (n_ % 2) {
+        uint32_t n_given = n_bins();
+        scratch_[0] = input[0].real();
+        for (uint32_t k = 1; k < n_given; k++) {
+            scratch_[k] = input[k];
+            scratch_[n_ - k] = std::conj(input[k]);
+        }
+        half_.inverse(scratch_.data(), scratch_.data());
+        for (uint32_t i = 0; i < n_; i++) {
+            output[i] = scratch_[i].real();
+        }
+        return;
+    }
+
+    // undoes forward's split: Z[k] = 2 E[k] + 2i O[k] with E[k] = (X[k] + conj(X[h - k])) / 2 and
+    // O[k] = conj(w^k) (X[k] - conj(X[h - k])) / 2, then the half sized inverse of Z gives n (x[2j] + i x[2j + 1])
+    uint32_t h = n_ / 2;
+    auto z = reinterpret_cast<std::complex<T> *>(output);
+    const std::complex<T> *tw = twiddles_->data();
+    T x0 = input[0].real(), xh = input[h].real();
+    z[0] = {x0 + xh, x0 - xh};
+    for (uint32_t k = 1; k <= h / 2; k++) {
+        // both ends are read before either is written, so this works in place
+        auto xk = input[k], xc = input[h - k];
+        auto even = xk + std::conj(xc);
+        auto diff = (xk - std::conj(xc)) * std::conj(tw[k]);
+        auto diff_c = (xc - std::conj(xk)) * -tw[k]; // conj(w^(h - k)) = -w^k
+        z[k] = even + std::complex<T>(-diff.imag(), diff.real());
+        z[h - k] = std::conj(even) + std::complex<T>(-diff_c.imag(), diff_c.real());
+    }
+    half_.inverse(z, z);
+}
+
+template struct rfft_plan<float>;
+template struct rfft_plan<double>;
+
+}
\ No newline at end of file
@@ -1,72 +1,72 @@
 #include "audio/fourier.hpp"
 
+#include <algorithm>
 #include <complex>
+#include <concepts>
 #include <cstdint>
-#include <numbers>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "audio.hpp"
+#include "frame.hpp"
 
 namespace audio {
 
-std::vector<wave_data> naive_ft(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec) {
-    // ala nyquist-shannon sampling thm., e.g. a 2 Hz wave requires at least 5 samples to always be represented
-    uint32_t max_freq = (n_samples - 1) / 2;
-    std::vector<wave_data> waves;
-    waves.reserve(max_freq + 1);
-
-    double inv_n_samples = 1. / n_samples;
-    double inv_duration = samples_per_sec * inv_n_samples;
-
-    // will need to divide freq by duration at the end to account for assumption of duration = 1s
-    for (uint32_t freq = 0; freq <= max_freq; freq++) {
-        std::complex<double> sum; // will need to divide by n_samples at the end to get correct amplitude
-        for (uint32_t i = 0; i < n_samples; i++) {
-            sum += static_cast<double>(input[i * in_spacing]) * std::polar(1., -2 * std::numbers::pi * freq * i / n_samples);
-        }
-        
-        waves.emplace_back(freq * inv_duration, std::abs(sum) * inv_n_samples * 2, std::arg(sum));
-    }
-
-    // recall that transform for freq and -freq collapse to double the transform of 0 Hz
-    // in the usual case, we have to double sum to get the correct amplitude of the wave
-    // but, since we doubled the transform of everything, we have to divide the amplitude of 0 Hz by 2 to get the correct value
-    waves[0].amplitude /= 2;
+template <std::floating_point T>
+std::vector<wave_data_t<T>> naive_ft(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, const window &win) {
+    rfft_plan<T> plan(n_samples);
+    prepared_window<T> prepared(win, n_samples);
+    std::vector<T> buffer;
+    std::vector<wave_data_t<T>> waves(ft_bins(n_samples));
+    plan_ft(plan, buffer, input, in_spacing, samples_per_sec, prepared.data(), prepared.amp_scale,
+        uint32_t(waves.size()), waves.data());
     return waves;
 }
 
+template std::vector<wave_data> naive_ft<double>(uint32_t, const float *, uint32_t, uint32_t, const window &);
+template std::vector<wave_dataf> naive_ft<float>(uint32_t, const float *, uint32_t, uint32_t, const window &);
+
 std::vector<wave_data> naive_ft_hann(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec) {
-    // ala nyquist-shannon sampling thm., e.g. a 2 Hz wave requires at least 5 samples to always be represented
-    uint32_t max_freq = (n_samples - 1) / 2;
-    std::vector<wave_data> waves;
-    waves.reserve(max_freq + 1);
-
-    double inv_n_samples = 1. / n_samples;
-    double inv_duration = samples_per_sec * inv_n_samples;
-
-    // will need to divide freq by duration at the end to account for assumption of duration = 1s
-    for (uint32_t freq = 0; freq <= max_freq; freq++) {
-        std::complex<double> sum; // will need to divide by n_samples at the end to get correct amplitude
-        for (uint32_t i = 0; i < n_samples; i++) {
-            auto t = 2 * std::numbers::pi * i / n_samples;
-            sum += static_cast<double>(input[i * in_spacing])
-                * std::polar(1., -t * freq)
-                * (0.5 - std::cos(t) / 2);
-        }
-        
-        // multiply by 4 instead of 2 to account for hann window
-        waves.emplace_back(freq * inv_duration, std::abs(sum) * inv_n_samples * 4, std::arg(sum));
+    // the hann window has a coherent gain of 1/2, so this multiplies by 4 instead of 2
+    return naive_ft<hann_window>(n_samples, input, in_spacing, samples_per_sec);
+}
+
+template <std::floating_point T>
+spectrogram<T> batch_ft(uint32_t n_signals, uint32_t n_samples, const float *input, std::size_t signal_stride,
+    uint32_t in_spacing, uint32_t samples_per_sec, const window &win, uint32_t n_threads) {
+    if (n_samples == 0) {
+        return spectrogram<T>(0u, n_signals, T(0)); // no bins, before (n_samples - 1) wraps around
     }
+    uint32_t n_freq = ft_bins(n_samples);
+    spectrogram<T> waves(n_freq, n_signals, static_cast<T>(samples_per_sec) / n_samples);
+
+    // same as naive_stft, just with the signals wherever the caller put them instead of every n_window_offset
+    auto &pool = thread_pool::global();
+    std::vector<rfft_plan<T>> plans(pool.size(), rfft_plan<T>(n_samples));
+    std::vector<std::vector<T>> buffers(pool.size());
+    prepared_window<T> prepared(win, n_samples);
+
+    pool.parallel_for(n_signals, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        for (std::size_t s = begin; s < end; s++) {
+            plan_ft(plans[worker], buffers[worker], input + s * signal_stride, in_spacing, prepared.data(),
+                prepared.amp_scale, n_freq, waves.mutable_re(uint32_t(s)), waves.mutable_im(uint32_t(s)));
+        }
+    }, n_threads);
 
-    // recall that transform for freq and -freq collapse to double the transform of 0 Hz
-    // in the usual case, we have to double sum to get the correct amplitude of the wave
-    // but, since we doubled the transform of everything, we have to divide the amplitude of 0 Hz by 2 to get the correct value
-    waves[0].amplitude /= 2;
     return waves;
 }
 
-stft_result<double> naive_stft(uint32_t n_samples, const float *input, uint32_t in_spacing,
-    uint32_t samples_per_sec, uint32_t n_window_offset, bool truncate, uint32_t n_window_size) {
+template spectrogram<double> batch_ft<double>(uint32_t, uint32_t, const float *, std::size_t, uint32_t, uint32_t,
+    const window &, uint32_t);
+template spectrogram<float> batch_ft<float>(uint32_t, uint32_t, const float *, std::size_t, uint32_t, uint32_t,
+    const window &, uint32_t);
+
+template <std::floating_point T>
+stft_result<T> naive_stft(uint32_t n_samples, const float *input, uint32_t in_spacing, uint32_t samples_per_sec,
+    uint32_t n_window_offset, bool truncate, uint32_t n_window_size, const window &win, uint32_t n_threads) {
     if (n_window_size == 0) {
         n_window_size = n_samples / n_window_offset;
     }
@@ -75,37 +75,149 @@ stft_result<double> naive_stft(uint32_t n_samples, const float *input, uint32_t
         return {};
     }
 
-    std::vector<wave_data> waves;
-    uint32_t n_freq = (n_window_size - 1) / 2;
-    uint32_t n_signals = (n_samples - n_window_size) / n_window_offset + 1;
-
-    uint32_t curr_off = 0;
-    for (; curr_off + n_window_size <= n_samples; curr_off += n_window_offset) {
-        auto signal = naive_ft(n_window_size, input + curr_off * in_spacing, in_spacing, samples_per_sec);
-        waves.insert(waves.end(), signal.begin(), signal.end());
-    }
-
-    std::vector<std::vector<wave_data>> trunc_waves;
-
-    // curr_off should now be at first offset where the window doesn't fully fit
+    uint32_t n_freq = stft_bins(n_window_size); // bins per window, including 0 Hz and nyquist
+    uint32_t n_full_signals = (n_samples - n_window_size) / n_window_offset + 1;
+    uint32_t n_signals = n_full_signals;
     if (truncate) {
-        for (; curr_off < n_samples; curr_off += n_window_offset) {
-            auto n_window_size = n_samples - curr_off;
-            trunc_waves.push_back(naive_ft(n_window_size, input + curr_off * in_spacing, in_spacing, samples_per_sec));
-        }
+        // every window starting before the end, the ones after the full ones get zero padded
+        n_signals = (n_samples - 1) / n_window_offset + 1;
     }
+    spectrogram<T> waves(n_freq, n_signals, static_cast<T>(samples_per_sec) / n_window_size);
+
+    // every worker gets its own copy of the plan (the tables are shared, the scratch isn't) and its own buffer.
+    // each window is computed the exact same way no matter which worker does it, so the result doesn't depend on
+    // the thread count
+    auto &pool = thread_pool::global();
+    std::vector<rfft_plan<T>> plans(pool.size(), rfft_plan<T>(n_window_size));
+    std::vector<std::vector<T>> buffers(pool.size());
+    std::vector<std::vector<float>> padded(pool.size());
+    prepared_window<T> prepared(win, n_window_size);
+
+    // windows are all the same size, so a few per chunk is enough to keep stealing overhead down
+    pool.parallel_for(n_signals, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        for (std::size_t s = begin; s < end; s++) {
+            const float *frame = input + s * n_window_offset * in_spacing;
+            uint32_t frame_spacing = in_spacing;
+            if (s >= n_full_signals) {
+                // copy what's left of the input and fill the rest of the window with zeros
+                auto &samples = padded[worker];
+                samples.assign(n_window_size, 0.f);
+                std::size_t n_left = n_samples - s * n_window_offset;
+                for (std::size_t i = 0; i < n_left; i++) {
+                    samples[i] = frame[i * in_spacing];
+                }
+                frame = samples.data();
+                frame_spacing = 1;
+            }
+            plan_ft(plans[worker], buffers[worker], frame, frame_spacing, prepared.data(), prepared.amp_scale,
+                n_freq, waves.mutable_re(uint32_t(s)), waves.mutable_im(uint32_t(s)));
+        }
+    }, n_threads);
 
     return {
-        waves,
+        std::move(waves),
         n_freq,
         n_signals,
-        static_cast<double>(samples_per_sec) / n_window_size, // freq_delta = 1 / window_duration
-        static_cast<double>(samples_per_sec) / n_window_size * n_freq, // freq_range = n_freq / window_duration
-        static_cast<double>(n_window_offset) / samples_per_sec, // time_delta = window_duration
-        static_cast<double>(n_window_offset) / samples_per_sec * n_signals, // time_range = n_signals * window_duration
-        trunc_waves,
-        uint32_t(n_signals + trunc_waves.size()) // n_total_signals
+        static_cast<T>(samples_per_sec) / n_window_size, // freq_delta = 1 / window_duration
+        static_cast<T>(samples_per_sec) / n_window_size * n_freq, // freq_range = n_freq / window_duration
+        static_cast<T>(n_window_offset) / samples_per_sec, // time_delta = window_duration
+        static_cast<T>(n_window_offset) / samples_per_sec * n_signals, // time_range = n_signals * window_duration
+        n_full_signals,
+        samples_per_sec,
+        n_samples,
+        n_window_size,
+        n_window_offset,
+        win
     };
 }
 
+template stft_result<double> naive_stft<double>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, bool, uint32_t,
+    const window &, uint32_t);
+template stft_result<float> naive_stft<float>(uint32_t, const float *, uint32_t, uint32_t, uint32_t, bool, uint32_t,
+    const window &, uint32_t);
+
+// undoes plan_ft for one frame: turns the complex amplitudes back into bins, inverse transforms them, multiplies by
+// the window again and adds that into output, along with the squared window into weights
+template <typename T>
+static void inverse_frame(rfft_plan<double> &plan, std::vector<double> &buffer, const T *re, const T *im,
+    uint32_t n_waves, const double *coefficients, double amp_scale, double *output, double *weights) {
+    uint32_t n_samples = plan.size();
+    buffer.resize(n_samples + 2);
+    auto bins = reinterpret_cast<std::complex<double> *>(buffer.data());
+    double inv_scale = 1. / amp_scale;
+    for (uint32_t k = 0; k < plan.n_bins(); k++) {
+        bins[k] = k < n_waves ? std::complex<double>(re[k] * inv_scale, im[k] * inv_scale) : 0.;
+    }
+    bins[0] *= 2; // plan_ft halved 0 Hz and nyquist
+    if (is_nyquist(n_waves - 1, n_samples)) {
+        bins[n_waves - 1] *= 2;
+    }
+    plan.inverse(bins, buffer.data());
+
+    // the frame is the samples times the window, so multiplying by the window again and dividing by the sum of
+    // squares later is the least squares estimate of the samples when frames overlap
+    double inv_n = 1. / n_samples;
+    for (uint32_t i = 0; i < n_samples; i++) {
+        double c = coefficients ? coefficients[i] : 1.;
+        output[i] += buffer[i] * inv_n * c;
+        weights[i] += c * c;
+    }
+}
+
+template <typename T>
+monosignal istft(const stft_result<T> &result, uint32_t n_threads) {
+    uint32_t n_window_size = result.n_window_size, n_window_offset = result.n_window_offset;
+    if (n_window_offset > n_window_size) {
+        throw std::invalid_argument("istft needs frames that overlap or touch, the offset is larger than the window");
+    }
+    if (result.n_signals > 0 && n_window_offset == 0) {
+        throw std::invalid_argument("istft needs a nonzero window offset");
+    }
+
+    // zero padded frames run past the end of the signal, their padding gets added in and dropped with the rest
+    std::size_t n_covered = result.n_samples;
+    if (result.n_signals > 0) {
+        n_covered = std::max(n_covered, std::size_t(result.n_signals - 1) * n_window_offset + n_window_size);
+    }
+    if (n_covered == 0) {
+        return {result.samples_per_sec, {}}; // e.g. the empty result naive_stft gives for a window longer than the signal
+    }
+    std::vector<double> output(n_covered), weights(n_covered);
+    if (result.n_signals > 0) {
+        auto &pool = thread_pool::global();
+        std::vector<rfft_plan<double>> plans(pool.size(), rfft_plan<double>(n_window_size));
+        std::vector<std::vector<double>> buffers(pool.size());
+        prepared_window prepared(result.win, n_window_size);
+
+        // frames n_rounds apart don't overlap, so each round adds a set of disjoint frames in parallel.
+        // every sample still gets its frames added in the same order, so the result doesn't depend on the thread count
+        uint32_t n_rounds = (n_window_size + n_window_offset - 1) / n_window_offset;
+        for (uint32_t round = 0; round < n_rounds && round < result.n_signals; round++) {
+            std::size_t n_frames = (result.n_signals - round + n_rounds - 1) / n_rounds;
+            pool.parallel_for(n_frames, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+                for (std::size_t i = begin; i < end; i++) {
+                    std::size_t s = round + i * n_rounds;
+                    std::size_t offset = s * n_window_offset;
+                    inverse_frame(plans[worker], buffers[worker], result.waves.re(uint32_t(s)),
+                        result.waves.im(uint32_t(s)), result.n_freq, prepared.data(), prepared.amp_scale,
+                        output.data() + offset, weights.data() + offset);
+                }
+            }, n_threads);
+        }
+    }
+
+    // near the ends of the signal only the tails of the window cover a sample, and dividing by their tiny weight
+    // would blow up whatever error the frame has (e.g. from edited bins), so the divisor is floored.
+    // those samples fade out instead, and ones no frame covers at all come out as 0
+    double floor = *std::max_element(weights.begin(), weights.end()) * 1e-3;
+    monosignal signal{result.samples_per_sec, std::vector<float>(result.n_samples)};
+    for (uint32_t i = 0; i < result.n_samples; i++) {
+        signal.data[i] = weights[i] > 0 ? static_cast<float>(output[i] / std::max(weights[i], floor)) : 0.f;
+    }
+    return signal;
+}
+
+template monosignal istft<float>(const stft_result<float> &, uint32_t);
+template monosignal istft<double>(const stft_result<double> &, uint32_t);
+
 }
\ No newline at end of file
@@ -82,8 +82,10 @@ static void compute_nstft(const float *input, uint32_t in_spacing,
         sum += input[i * in_spacing] * cuda::std::polar<float>(1, -2 * std::numbers::pi_v<float> * freq_div_n_samples * i);
     }
     
+    // 0 Hz and nyquist have no negative twin, so they aren't doubled like the rest
+    bool single = freq == 0 || 2 * freq == n_window_size;
     out[wave].freq = freq * inv_duration;
-    out[wave].amplitude = cuda::std::abs(sum) * inv_n_window_size * 2;
+    out[wave].amplitude = cuda::std::abs(sum) * inv_n_window_size * (single ? 1 : 2);
     out[wave].phase = cuda::std::arg(sum);
 }
 
@@ -93,7 +95,7 @@ stft_result<float> naive_stft_gpu(uint32_t n_samples, const float *input, uint32
         n_window_size = n_samples / n_window_offset;
     }
 
-    uint32_t n_freq = (n_window_size - 1) / 2 + 1;
+    uint32_t n_freq = n_window_size / 2 + 1; // including nyquist, like naive_stft
 
     if (n_window_size > n_samples) {
         return {
@@ -104,8 +106,12 @@ stft_result<float> naive_stft_gpu(uint32_t n_samples, const float *input, uint32
             static_cast<float>(samples_per_sec) / n_window_size * n_freq, // freq_range = n_freq / window_duration
             static_cast<float>(n_window_offset) / samples_per_sec, // time_delta = window_duration
             0, // time_range = n_signals * window_duration
-            {},
-            0 // n_total_signals
+            0, // n_full_signals
+            samples_per_sec,
+            n_samples,
+            n_window_size,
+            n_window_offset,
+            {} // rectangular
         };
     }
 
@@ -127,12 +133,19 @@ stft_result<float> naive_stft_gpu(uint32_t n_samples, const float *input, uint32
     cudaDeviceSynchronize();
     std::cout << std::endl;
 
-    std::vector<wave_dataf> waves{n_waves};
-    cudaMemcpy(waves.data(), g_waves, sizeof(wave_dataf) * n_waves, cudaMemcpyDeviceToHost);
+    std::vector<wave_dataf> device_waves(n_waves);
+    cudaMemcpy(device_waves.data(), g_waves, sizeof(wave_dataf) * n_waves, cudaMemcpyDeviceToHost);
 
     cudaFree(g_waves);
     cudaFree(g_input);
 
+    spectrogram<float> waves(n_freq, n_signal, static_cast<float>(samples_per_sec) / n_window_size);
+    for (uint32_t s = 0; s < n_signal; s++) {
+        for (uint32_t f = 0; f < n_freq; f++) {
+            waves.set(s, f, device_waves[s * n_freq + f]);
+        }
+    }
+
     return {
         waves,
         n_freq,
@@ -141,8 +154,12 @@ stft_result<float> naive_stft_gpu(uint32_t n_samples, const float *input, uint32
         static_cast<float>(samples_per_sec) / n_window_size * n_freq, // freq_range = n_freq / window_duration
         static_cast<float>(n_window_offset) / samples_per_sec, // time_delta = window_duration
         static_cast<float>(n_window_offset) / samples_per_sec * n_signal, // time_range = n_signal * window_duration
-        {}, // unimplemented
-        uint32_t(n_signal + 0 /* trunc_waves.size() */) // n_total_signals
+        n_signal, // n_full_signals, zero padded tails are unimplemented
+        samples_per_sec,
+        n_samples,
+        n_window_size,
+        n_window_offset,
+        {} // rectangular
     };
 }
 
@@ -0,0 +1,109 @@
+#pragma once
+
+// pieces shared by the transforms that turn windows of samples into waves, not part of the public headers
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio/fft.hpp"
+#include "audio/simd.hpp"
+#include "audio/wave_data.hpp"
+#include "audio/window.hpp"
+
+namespace audio {
+
+// windows one frame of input and transforms it with plan, returning its n / 2 + 1 bins (which live in buffer)
+// coefficients is an optional array of n window coefficients to multiply the input by
+template <typename T>
+const std::complex<T> *frame_bins(rfft_plan<T> &plan, std::vector<T> &buffer, const float *input, uint32_t in_spacing,
+    const T *coefficients) {
+    uint32_t n_samples = plan.size();
+    // the bins are written over the samples, n / 2 + 1 complex bins take up n + 2 reals
+    buffer.resize(n_samples + 2);
+    simd::active<T>().window_apply(n_samples, input, in_spacing, coefficients, buffer.data());
+    auto bins = reinterpret_cast<std::complex<T> *>(buffer.data());
+    plan.forward(buffer.data(), bins);
+    return bins;
+}
+
+// bins naive_ft keeps for n samples, up to (n - 1) / 2
+// ala nyquist-shannon sampling thm., e.g. a 2 Hz wave requires at least 5 samples to always be represented
+inline uint32_t ft_bins(uint32_t n) {
+    return (n - 1) / 2 + 1;
+}
+
+// bins the stfts keep per frame, all n / 2 + 1 of the rfft's, so even sized windows keep their nyquist bin and
+// istft can give the samples back exactly
+inline uint32_t stft_bins(uint32_t n) {
+    return n / 2 + 1;
+}
+
+// whether bin is the nyquist bin of an n sample transform, which like 0 Hz has no negative twin
+inline bool is_nyquist(uint32_t bin, uint32_t n) {
+    return n % 2 == 0 && bin == n / 2;
+}
+
+// transforms one window of input with plan and converts its first n_waves bins into waves, written to out
+// (n_waves is ft_bins or stft_bins of the plan's size)
+// amp_scale is the factor applied to |X| to get the amplitude of a wave (2 / n without a window)
+template <typename T>
+void plan_ft(rfft_plan<T> &plan, std::vector<T> &buffer, const float *input, uint32_t in_spacing,
+    uint32_t samples_per_sec, const T *coefficients, T amp_scale, uint32_t n_waves, wave_data_t<T> *waves) {
+    uint32_t n_samples = plan.size();
+    auto bins = frame_bins(plan, buffer, input, in_spacing, coefficients);
+
+    // the transform assumes duration = 1s, so divide freq by duration to get the frequency in Hz
+    double inv_duration = static_cast<double>(samples_per_sec) / n_samples;
+    for (uint32_t freq = 0; freq < n_waves; freq++) {
+        waves[freq] = {static_cast<T>(freq * inv_duration), std::abs(bins[freq]) * amp_scale, std::arg(bins[freq])};
+    }
+
+    // recall that transform for freq and -freq collapse to double the transform of 0 Hz
+    // in the usual case, we have to double sum to get the correct amplitude of the wave
+    // but, since we doubled the transform of everything, we have to divide the amplitude of 0 Hz by 2 to get the correct value
+    // (and the same for nyquist, when it's there)
+    waves[0].amplitude /= 2;
+    if (is_nyquist(n_waves - 1, n_samples)) {
+        waves[n_waves - 1].amplitude /= 2;
+    }
+}
+
+// like plan_ft, but only scaling the bins into the complex amplitudes of a spectrogram's rows, re and im
+template <typename T>
+void plan_ft(rfft_plan<T> &plan, std::vector<T> &buffer, const float *input, uint32_t in_spacing,
+    const T *coefficients, T amp_scale, uint32_t n_bins, T *re, T *im) {
+    auto bins = frame_bins(plan, buffer, input, in_spacing, coefficients);
+    for (uint32_t freq = 0; freq < n_bins; freq++) {
+        T scale = freq == 0 || is_nyquist(freq, plan.size()) ? amp_scale / 2 : amp_scale; // same as above
+        re[freq] = bins[freq].real() * scale;
+        im[freq] = bins[freq].imag() * scale;
+    }
+}
+
+// coefficients of win for n samples (nullptr for a rectangular window, so window_apply skips the multiply)
+// and the factor to scale |X| by to get amplitudes, 2 / coherent gain
+template <typename T = double>
+struct prepared_window {
+    prepared_window(const window &win, uint32_t n) : amp_scale{static_cast<T>(2. / n)} {
+        if (win.type == window_type::rectangular) {
+            return;
+        }
+        coefficients = window_coefficients<T>(win, n);
+        double sum = 0;
+        for (auto c : *coefficients) {
+            sum += c;
+        }
+        amp_scale = static_cast<T>(2. / sum);
+    }
+
+    const T *data() const {
+        return coefficients ? coefficients->data() : nullptr;
+    }
+
+    std::shared_ptr<const std::vector<T>> coefficients;
+    T amp_scale;
+};
+
+}
@@ -0,0 +1,95 @@
+#include "audio/goertzel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "audio/simd.hpp"
+#include "frame.hpp"
+
+namespace audio {
+
+goertzel_bank::goertzel_bank(uint32_t samples_per_sec, std::vector<double> freqs)
+    : samples_per_sec_{samples_per_sec}, freqs_{std::move(freqs)}, n_samples_{0} {
+    coeff_.reserve(freqs_.size());
+    for (auto freq : freqs_) {
+        if (freq < 0 || freq >= samples_per_sec / 2.) {
+            throw std::invalid_argument("goertzel_bank frequency out of range");
+        }
+        coeff_.push_back(2 * std::cos(2 * std::numbers::pi * freq / samples_per_sec));
+    }
+    s1_.resize(freqs_.size());
+    s2_.resize(freqs_.size());
+}
+
+void goertzel_bank::finish(const double *s1, const double *s2, uint64_t n_samples, double amp_scale,
+    wave_data *out) const {
+    for (std::size_t j = 0; j < freqs_.size(); j++) {
+        // after n samples the filter holds e^(iω(n - 1)) X(ω) = s1 - e^(-iω) s2, where X is the dft at ω with the
+        // phase measured from the first sample. the rotation back is done in revolutions to keep it exact for long blocks
+        double revs = freqs_[j] / samples_per_sec_;
+        auto step = std::polar(1., -2 * std::numbers::pi * revs);
+        double back = revs * double(n_samples - 1);
+        back -= std::floor(back);
+        auto bin = (s1[j] - step * s2[j]) * std::polar(1., -2 * std::numbers::pi * back);
+
+        out[j] = {freqs_[j], std::abs(bin) * amp_scale, std::arg(bin)};
+        if (freqs_[j] == 0) {
+            out[j].amplitude /= 2; // same as naive_ft
+        }
+    }
+}
+
+std::vector<wave_data> goertzel_bank::transform(uint32_t n_samples, const float *input, uint32_t in_spacing,
+    const window &win) const {
+    std::vector<wave_data> out(freqs_.size());
+    if (n_samples == 0) {
+        for (std::size_t j = 0; j < freqs_.size(); j++) {
+            out[j].freq = freqs_[j];
+        }
+        return out;
+    }
+
+    std::vector<double> s1(freqs_.size()), s2(freqs_.size());
+    prepared_window prepared(win, n_samples);
+    simd::active<double>().goertzel(n_samples, input, in_spacing, prepared.data(), freqs_.size(), coeff_.data(),
+        s1.data(), s2.data());
+    finish(s1.data(), s2.data(), n_samples, prepared.amp_scale, out.data());
+    return out;
+}
+
+void goertzel_bank::push(uint32_t n_samples, const float *input, uint32_t in_spacing) {
+    simd::active<double>().goertzel(n_samples, input, in_spacing, nullptr, freqs_.size(), coeff_.data(), s1_.data(),
+        s2_.data());
+    n_samples_ += n_samples;
+}
+
+void goertzel_bank::waves(wave_data *out) const {
+    if (n_samples_ == 0) {
+        std::fill(out, out + freqs_.size(), wave_data{});
+        for (std::size_t j = 0; j < freqs_.size(); j++) {
+            out[j].freq = freqs_[j];
+        }
+        return;
+    }
+    finish(s1_.data(), s2_.data(), n_samples_, 2. / n_samples_, out);
+}
+
+std::vector<wave_data> goertzel_bank::waves() const {
+    std::vector<wave_data> out(freqs_.size());
+    waves(out.data());
+    return out;
+}
+
+void goertzel_bank::reset() {
+    std::fill(s1_.begin(), s1_.end(), 0.);
+    std::fill(s2_.begin(), s2_.end(), 0.);
+    n_samples_ = 0;
+}
+
+}
@@ -1,7 +1,14 @@
 #include "audio/monosignal.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <numbers>
+#include <utility>
 #include <vector>
 
 #include "miniaudio/miniaudio.h"
@@ -41,40 +48,240 @@ void monosignal::play() const {
     while (ma_sound_is_playing(&sound));
 }
 
+// the waves of a signal as rotators, structure of arrays so the kernel can run across them
+// frequencies and phases are kept in revolutions (per sample) so the phase at any sample can be reduced exactly
+struct oscillator_bank {
+    // samples between re-anchoring the rotators to their exact phase, bounds how far rounding errors can pile up
+    static constexpr uint32_t block_size = 1024;
+
+    template <typename T>
+    oscillator_bank(const std::vector<wave_data_t<T>> &waves, uint32_t samples_per_sec) {
+        for (const auto &w : waves) {
+            if (w.amplitude == 0) {
+                continue;
+            }
+            double revs = static_cast<double>(w.freq) / samples_per_sec;
+            revs_.push_back(revs);
+            amplitude_.push_back(w.amplitude);
+            phase_.push_back(static_cast<double>(w.phase) / (2 * std::numbers::pi));
+            auto step = std::polar(1., 2 * std::numbers::pi * revs);
+            step_re_.push_back(step.real());
+            step_im_.push_back(step.imag());
+        }
+    }
+
+    std::size_t size() const {
+        return revs_.size();
+    }
+
+    /**
+     * adds samples [first, first + n) of the sum of the waves into out, n at most block_size
+     * z_re and z_im are scratch space for size() values, so several threads can render different blocks at once
+     */
+    void render(uint64_t first, std::size_t n, double *z_re, double *z_im, double *out) const {
+        for (std::size_t j = 0; j < revs_.size(); j++) {
+            // the fractional part of f first + φ / 2π is the exact phase at first, however far along that is,
+            // so a block comes out the same no matter which blocks were rendered before it
+            double revs = revs_[j] * static_cast<double>(first) + phase_[j];
+            revs -= std::floor(revs);
+            auto z = std::polar(amplitude_[j], 2 * std::numbers::pi * revs);
+            z_re[j] = z.real();
+            z_im[j] = z.imag();
+        }
+        simd::active<double>().oscillate(n, revs_.size(), z_re, z_im, step_re_.data(), step_im_.data(), out);
+    }
+
+    std::vector<double> revs_;
+    std::vector<double> amplitude_;
+    std::vector<double> phase_; // in revolutions
+    std::vector<double> step_re_; // e^(2πi revs)
+    std::vector<double> step_im_;
+};
+
+// largest grid render_grid will build, 64 Mi samples of doubles
+static constexpr uint64_t max_grid_size = uint64_t(1) << 26;
+
+// whether every wave makes a whole number of cycles in grid_size samples, up to rounding in the frequencies
+template <typename T>
+static bool fits_grid(const std::vector<wave_data_t<T>> &waves, uint32_t samples_per_sec, uint64_t grid_size) {
+    for (const auto &w : waves) {
+        double k = static_cast<double>(w.freq) * grid_size / samples_per_sec;
+        // frequencies come in with T's rounding on them, which scales with k
+        double tolerance = std::max(1e-6, std::abs(k) * std::numeric_limits<T>::epsilon() * 64);
+        if (std::abs(k - std::round(k)) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the smallest q (up to max_q, 0 if it'd take more) with some p / q within tolerance of x, from the convergents of
+// x's continued fraction. any other fraction that close has a bigger denominator
+static uint64_t rational_denominator(double x, double tolerance, uint64_t max_q) {
+    // convergents p / q start from 1 / 0, with 0 / 1 before that
+    uint64_t p_prev = 0, q_prev = 1, p = 1, q = 0;
+    double rest = x;
+    while (q == 0 || std::abs(x - double(p) / q) > tolerance) {
+        double a = std::floor(rest);
+        if (a > double(max_q)) {
+            return 0; // checked before converting, a can be far past what a uint64_t holds
+        }
+        uint64_t p_next = uint64_t(a) * p + p_prev, q_next = uint64_t(a) * q + q_prev;
+        if (q_next > max_q) {
+            return 0;
+        }
+        p_prev = p, q_prev = q, p = p_next, q = q_next;
+        if (rest == a) {
+            break;
+        }
+        rest = 1 / (rest - a);
+    }
+    return q;
+}
+
+// the smallest number of samples every wave makes a whole number of cycles in, or 0 if there isn't one up to
+// max_grid_size. that's the lcm of the denominators of the frequencies as fractions of samples_per_sec, which can only
+// be found when the frequencies are precise enough to tell fractions apart: wave_data works for grids up to millions
+// of samples, wave_dataf only up to a few thousand
+template <typename T>
+static uint64_t detect_grid(const std::vector<wave_data_t<T>> &waves, uint32_t samples_per_sec) {
+    uint64_t grid_size = 1;
+    for (const auto &w : waves) {
+        double revs = std::abs(static_cast<double>(w.freq)) / samples_per_sec;
+        revs -= std::floor(revs);
+        auto q = rational_denominator(revs, revs * std::numeric_limits<T>::epsilon() * 64, max_grid_size);
+        if (q == 0) {
+            return 0;
+        }
+        grid_size = std::lcm(grid_size, q);
+        if (grid_size > max_grid_size) {
+            return 0;
+        }
+    }
+    return fits_grid(waves, samples_per_sec, grid_size) ? grid_size : 0;
+}
+
+// one period of the waves through one inverse fft of grid_size samples
+template <typename T>
+static std::vector<double> render_grid(const std::vector<wave_data_t<T>> &waves, uint32_t samples_per_sec,
+    uint32_t grid_size) {
+    rfft_plan<double> plan(grid_size);
+    std::vector<double> buffer(std::size_t(grid_size) + 2);
+    auto bins = reinterpret_cast<std::complex<double> *>(buffer.data());
+
+    // A cos(2πki/P + φ) = Re(A e^(iφ) e^(2πiki/P)), which the inverse gives from A/2 e^(iφ) in bin k and its
+    // conjugate in bin P - k. 0 Hz and nyquist don't have a twin, so they get the real part A cos φ in full
+    for (const auto &w : waves) {
+        auto k = std::llround(static_cast<double>(w.freq) * grid_size / samples_per_sec) % int64_t(grid_size);
+        double phase = w.phase;
+        if (k < 0) {
+            k += grid_size;
+        }
+        if (2 * k > int64_t(grid_size)) { // above nyquist, it's the same as the mirrored frequency going backwards
+            k = grid_size - k;
+            phase = -phase;
+        }
+        if (k == 0 || 2 * k == int64_t(grid_size)) {
+            bins[k] += w.amplitude * std::cos(phase);
+        } else {
+            bins[k] += std::polar<double>(w.amplitude / 2, phase);
+        }
+    }
+    plan.inverse(bins, buffer.data());
+    buffer.resize(grid_size);
+    return buffer;
+}
+
 template <typename T>
 monosignal generate_monosignal(const std::vector<wave_data_t<T>> &waves, double time, uint32_t samples_per_sec,
-    bool normalize, bool always_normalize) {
+    bool normalize, bool always_normalize, synthesis_mode mode, uint32_t grid_size, uint32_t n_threads) {
 
-    monosignal sig{samples_per_sec, std::vector(std::size_t(time * samples_per_sec), 0.f)};
+    monosignal sig{samples_per_sec, std::vector<float>(std::size_t(time * samples_per_sec))};
+    std::size_t n_samples = sig.data.size();
 
-    auto time_step = 1. / samples_per_sec;
-    for (std::size_t i = 0; i < sig.data.size(); i++) {
-        for (const auto &w : waves) {
-            sig.data[i] += w.amplitude * std::cos(2 * std::numbers::pi * w.freq * i * time_step + w.phase);
+    uint64_t grid = 0;
+    if (mode != synthesis_mode::oscillators) {
+        grid = grid_size && fits_grid(waves, samples_per_sec, grid_size) ? grid_size : detect_grid(waves, samples_per_sec);
+    }
+    if (grid && mode == synthesis_mode::automatic) {
+        // rough costs measured on both paths: an fft sample costs about as much as 8 oscillator steps
+        // per level of the transform. past the end of the signal the grid is wasted work
+        double fft_cost = 8. * grid * std::log2(double(grid) + 1);
+        double oscillator_cost = double(waves.size()) * n_samples;
+        if (fft_cost >= oscillator_cost) {
+            grid = 0;
         }
     }
 
-    if (!normalize) {
+    // the signal is made in blocks of oscillator_bank::block_size samples spread over the pool. each block starts
+    // from exact phases, so where the blocks go doesn't change the result. the peak is tracked on the way, so
+    // normalizing doesn't take another pass to find it
+    auto &pool = thread_pool::global();
+    std::size_t n_blocks = (n_samples + oscillator_bank::block_size - 1) / oscillator_bank::block_size;
+    std::vector<float> peaks(pool.size());
+
+    if (grid) {
+        auto period = render_grid(waves, samples_per_sec, uint32_t(grid));
+
+        // the signal only ever repeats this one period, so its peak is known before any copying
+        float max = 0;
+        for (std::size_t i = 0; i < std::min<std::size_t>(period.size(), n_samples); i++) {
+            max = std::max(max, std::abs(static_cast<float>(period[i])));
+        }
+        bool scaled = normalize && max > 0 && (always_normalize || max > 1);
+        pool.parallel_for(n_blocks, 16, [&](std::size_t begin, std::size_t end, unsigned) {
+            std::size_t last = std::min(n_samples, end * oscillator_bank::block_size);
+            for (std::size_t i = begin * oscillator_bank::block_size; i < last; i++) {
+                auto sample = static_cast<float>(period[i % period.size()]);
+                sig.data[i] = scaled ? sample / max : sample;
+            }
+        }, n_threads);
         return sig;
     }
 
-    float max = 0;
-    for (const auto &sample : sig.data) {
-        if (std::abs(sample) > max) {
-            max = std::abs(sample);
+    oscillator_bank bank(waves, samples_per_sec);
+    struct scratch {
+        std::vector<double> z_re, z_im, block;
+    };
+    std::vector<scratch> scratches(pool.size());
+    pool.parallel_for(n_blocks, 1, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        auto &[z_re, z_im, block] = scratches[worker];
+        z_re.resize(bank.size());
+        z_im.resize(bank.size());
+        block.resize(oscillator_bank::block_size);
+        float peak = peaks[worker];
+        for (std::size_t b = begin; b < end; b++) {
+            std::size_t first = b * oscillator_bank::block_size;
+            std::size_t n = std::min<std::size_t>(oscillator_bank::block_size, n_samples - first);
+            std::fill(block.begin(), block.begin() + n, 0.);
+            bank.render(first, n, z_re.data(), z_im.data(), block.data());
+            for (std::size_t i = 0; i < n; i++) {
+                auto sample = static_cast<float>(block[i]);
+                sig.data[first + i] = sample;
+                peak = std::max(peak, std::abs(sample));
+            }
         }
+        peaks[worker] = peak;
+    }, n_threads);
+
+    float max = *std::max_element(peaks.begin(), peaks.end());
+    if (!normalize || max == 0 || !(always_normalize || max > 1)) {
+        return sig;
     }
 
-    if (always_normalize || max > 1) {
-        for (auto &sample : sig.data) {
-            sample /= max;
+    pool.parallel_for(n_blocks, 16, [&](std::size_t begin, std::size_t end, unsigned) {
+        std::size_t last = std::min(n_samples, end * oscillator_bank::block_size);
+        for (std::size_t i = begin * oscillator_bank::block_size; i < last; i++) {
+            sig.data[i] /= max;
         }
-    }
+    }, n_threads);
 
     return sig;
 }
 
-template monosignal generate_monosignal<double>(const std::vector<wave_data> &, double, uint32_t, bool, bool);
-template monosignal generate_monosignal<float>(const std::vector<wave_dataf> &, double, uint32_t, bool, bool);
+template monosignal generate_monosignal<double>(const std::vector<wave_data> &, double, uint32_t, bool, bool,
+    synthesis_mode, uint32_t, uint32_t);
+template monosignal generate_monosignal<float>(const std::vector<wave_dataf> &, double, uint32_t, bool, bool,
+    synthesis_mode, uint32_t, uint32_t);
 
 }
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "audio/partials.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <numbers>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "audio/peaks.hpp"
+#include "audio/thread_pool.hpp"
+
+namespace audio {
+
+template <std::floating_point T>
+partial_stream track_partials(const stft_result<T> &result, uint32_t max_peaks, double max_jump,
+    double min_amplitude, uint32_t min_length, uint32_t n_threads) {
+    auto peaks = find_peaks(result, max_peaks, 0, peak_interpolation::gaussian, n_threads);
+    const double tau = 2 * std::numbers::pi;
+    // the peaks' phases are at the frame's first sample, the points' at its middle
+    const double half_window = result.n_window_size / 2. / result.samples_per_sec;
+
+    struct alive_track {
+        uint32_t id;
+        double freq;
+    };
+    struct match {
+        double distance;
+        uint32_t track, peak;
+        auto operator<=>(const match &) const = default;
+    };
+
+    std::vector<partial_point> points; // with provisional ids, one per track ever born
+    std::vector<uint32_t> lengths; // of every provisional id
+    std::vector<alive_track> alive, next;
+    std::vector<wave_data_t<T>> candidates;
+    std::vector<match> matches;
+    std::vector<char> track_used, peak_used;
+
+    for (uint32_t s = 0; s < result.n_signals; s++) {
+        candidates.clear();
+        for (const auto &peak : peaks[s]) {
+            if (peak.amplitude >= min_amplitude) {
+                candidates.push_back(peak);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) { return a.freq < b.freq; });
+
+        // every track/peak pair close enough, matched closest first
+        matches.clear();
+        for (uint32_t j = 0; j < alive.size(); j++) {
+            auto first = std::lower_bound(candidates.begin(), candidates.end(), alive[j].freq - max_jump,
+                [](const auto &peak, double freq) { return peak.freq < freq; });
+            for (auto it = first; it != candidates.end() && it->freq <= alive[j].freq + max_jump; ++it) {
+                matches.push_back({std::abs(it->freq - alive[j].freq), j, uint32_t(it - candidates.begin())});
+            }
+        }
+        std::sort(matches.begin(), matches.end());
+
+        auto add_point = [&](uint32_t id, const wave_data_t<T> &peak) {
+            double phase = std::remainder(peak.phase + tau * peak.freq * half_window, tau);
+            points.push_back({id, s, float(peak.freq), float(peak.amplitude), float(phase)});
+            next.push_back({id, double(peak.freq)});
+            lengths[id]++;
+        };
+
+        std::size_t frame_first = points.size();
+        next.clear();
+        track_used.assign(alive.size(), 0);
+        peak_used.assign(candidates.size(), 0);
+        for (const auto &m : matches) {
+            if (!track_used[m.track] && !peak_used[m.peak]) {
+                track_used[m.track] = peak_used[m.peak] = 1;
+                add_point(alive[m.track].id, candidates[m.peak]);
+            }
+        }
+        // tracks without a peak die here, peaks without a track are born
+        for (uint32_t i = 0; i < candidates.size(); i++) {
+            if (!peak_used[i]) {
+                lengths.push_back(0);
+                add_point(uint32_t(lengths.size() - 1), candidates[i]);
+            }
+        }
+        std::sort(points.begin() + frame_first, points.end(),
+            [](const partial_point &a, const partial_point &b) { return a.track < b.track; });
+        std::swap(alive, next);
+    }
+
+    // drop the short tracks, numbering the rest in the same order so frames stay sorted by track
+    std::vector<uint32_t> ids(lengths.size());
+    uint32_t n_tracks = 0;
+    for (std::size_t id = 0; id < lengths.size(); id++) {
+        ids[id] = lengths[id] >= min_length ? n_tracks++ : UINT32_MAX;
+    }
+    std::size_t kept = 0;
+    for (const auto &point : points) {
+        if (ids[point.track] != UINT32_MAX) {
+            points[kept] = point;
+            points[kept++].track = ids[point.track];
+        }
+    }
+    points.resize(kept);
+
+    return {
+        std::move(points),
+        n_tracks,
+        result.n_signals,
+        result.samples_per_sec,
+        result.n_samples,
+        result.n_window_size,
+        result.n_window_offset
+    };
+}
+
+template partial_stream track_partials<float>(const stft_result<float> &, uint32_t, double, double, uint32_t,
+    uint32_t);
+template partial_stream track_partials<double>(const stft_result<double> &, uint32_t, double, double, uint32_t,
+    uint32_t);
+
+monosignal synthesize_partials(const partial_stream &stream, uint32_t n_threads) {
+    monosignal sig{stream.samples_per_sec, std::vector<float>(stream.n_samples)};
+    if (stream.n_frames == 0 || stream.points.empty()) {
+        return sig;
+    }
+
+    // points of frame s are [first[s], first[s + 1])
+    std::vector<std::size_t> first(stream.n_frames + 1, 0);
+    for (const auto &point : stream.points) {
+        first[point.frame + 1]++;
+    }
+    for (uint32_t s = 0; s < stream.n_frames; s++) {
+        first[s + 1] += first[s];
+    }
+
+    const double tau = 2 * std::numbers::pi;
+    const double hop = stream.n_window_offset;
+    const double to_omega = tau / stream.samples_per_sec; // Hz to radians per sample
+
+    // hop j runs from the middle of frame j - 1 to the middle of frame j, hop 0 is the fade in before frame 0 and
+    // hop n_frames the fade out after the last frame
+    auto &pool = thread_pool::global();
+    std::vector<std::vector<double>> buffers(pool.size());
+    pool.parallel_for(std::size_t(stream.n_frames) + 1, 4, [&](std::size_t begin, std::size_t end, unsigned worker) {
+        auto &buffer = buffers[worker];
+        for (std::size_t j = begin; j < end; j++) {
+            double start = j == 0 ? stream.frame_center(0) - hop : stream.frame_center(uint32_t(j - 1));
+            auto first_sample = int64_t(std::max(0., std::ceil(start)));
+            auto last_sample = std::min<int64_t>(stream.n_samples, int64_t(std::ceil(start + hop)));
+            if (first_sample >= last_sample) {
+                continue;
+            }
+            buffer.assign(std::size_t(last_sample - first_sample), 0.);
+
+            // merge frame j - 1's points with frame j's by track
+            std::size_t a = j > 0 ? first[j - 1] : 0, a_end = j > 0 ? first[j] : 0;
+            std::size_t b = j < stream.n_frames ? first[j] : 0, b_end = j < stream.n_frames ? first[j + 1] : 0;
+            while (a < a_end || b < b_end) {
+                const partial_point *from = nullptr, *to = nullptr;
+                if (b == b_end || (a < a_end && stream.points[a].track < stream.points[b].track)) {
+                    from = &stream.points[a++]; // dies
+                } else if (a == a_end || stream.points[b].track < stream.points[a].track) {
+                    to = &stream.points[b++]; // is born
+                } else {
+                    from = &stream.points[a++];
+                    to = &stream.points[b++];
+                }
+
+                double t0 = first_sample - start;
+                if (from && to) {
+                    // mcaulay-quatieri: the cubic through both phases and frequencies that bends the least, picked by
+                    // how many whole turns (m) get added to the end phase
+                    double theta0 = from->phase, omega0 = from->freq * to_omega;
+                    double theta1 = to->phase, omega1 = to->freq * to_omega;
+                    double m = std::round(((theta0 + omega0 * hop - theta1) + (omega1 - omega0) * hop / 2) / tau);
+                    double x = theta1 + tau * m - theta0 - omega0 * hop, y = omega1 - omega0;
+                    double alpha = 3 * x / (hop * hop) - y / hop;
+                    double beta = -2 * x / (hop * hop * hop) + y / (hop * hop);
+                    double slope = (to->amplitude - from->amplitude) / hop;
+                    for (std::size_t i = 0; i < buffer.size(); i++) {
+                        double t = t0 + double(i);
+                        double theta = theta0 + t * (omega0 + t * (alpha + t * beta));
+                        buffer[i] += (from->amplitude + slope * t) * std::cos(theta);
+                    }
+                } else if (from) {
+                    double omega = from->freq * to_omega;
+                    for (std::size_t i = 0; i < buffer.size(); i++) {
+                        double t = t0 + double(i);
+                        buffer[i] += from->amplitude * (1 - t / hop) * std::cos(from->phase + omega * t);
+                    }
+                } else {
+                    // measured back from frame j's middle
+                    double omega = to->freq * to_omega;
+                    for (std::size_t i = 0; i < buffer.size(); i++) {
+                        double t = t0 + double(i) - hop;
+                        buffer[i] += to->amplitude * (1 + t / hop) * std::cos(to->phase + omega * t);
+                    }
+                }
+            }
+
+            std::transform(buffer.begin(), buffer.end(), sig.data.begin() + first_sample,
+                [](double sample) { return static_cast<float>(sample); });
+        }
+    }, n_threads);
+
+    return sig;
+}
+
+namespace {
+
+struct partial_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_tracks;
+    uint32_t n_frames;
+    uint32_t samples_per_sec;
+    uint32_t n_samples;
+    uint32_t n_window_size;
+    uint32_t n_window_offset;
+    uint32_t reserved;
+    uint64_t n_points;
+};
+
+constexpr char partial_magic[8] = {'A', 'U', 'D', 'P', 'A', 'R', 'T', '\0'};
+constexpr uint32_t partial_version = 1;
+
+static_assert(sizeof(partial_point) == 20, "partial stream files store points as they are in memory");
+
+}
+
+void write_partials_to_file(const std::filesystem::path &path, const partial_stream &stream) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error(std::format("couldn't open {} for writing", path.string()));
+    }
+
+    partial_file_header header{};
+    std::memcpy(header.magic, partial_magic, sizeof(partial_magic));
+    header.version = partial_version;
+    header.n_tracks = stream.n_tracks;
+    header.n_frames = stream.n_frames;
+    header.samples_per_sec = stream.samples_per_sec;
+    header.n_samples = stream.n_samples;
+    header.n_window_size = stream.n_window_size;
+    header.n_window_offset = stream.n_window_offset;
+    header.n_points = stream.points.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(stream.points.data()),
+        std::streamsize(stream.points.size() * sizeof(partial_point)));
+    if (!file) {
+        throw std::runtime_error(std::format("couldn't write to {}", path.string()));
+    }
+}
+
+partial_stream read_partials_from_file(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("couldn't open {}", path.string()));
+    }
+
+    partial_file_header header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || std::memcmp(header.magic, partial_magic, sizeof(partial_magic)) != 0) {
+        throw std::runtime_error(std::format("{} isn't a partial stream file", path.string()));
+    }
+    if (header.version != partial_version) {
+        throw std::runtime_error(std::format("{} is a partial stream of an unsupported version", path.string()));
+    }
+
+    partial_stream stream{{}, header.n_tracks, header.n_frames, header.samples_per_sec, header.n_samples,
+        header.n_window_size, header.n_window_offset};
+    // read in chunks rather than trusting n_points with one huge allocation
+    constexpr std::size_t chunk = 1 << 16;
+    for (uint64_t left = header.n_points; left > 0;) {
+        std::size_t count = std::size_t(std::min<uint64_t>(left, chunk));
+        std::size_t old_size = stream.points.size();
+        stream.points.resize(old_size + count);
+        if (!file.read(reinterpret_cast<char *>(stream.points.data() + old_size),
+                std::streamsize(count * sizeof(partial_point)))) {
+            throw std::runtime_error(std::format("{} is truncated", path.string()));
+        }
+        left -= count;
+    }
+
+    // synthesize_partials indexes by frame and merges by track, so check the order it relies on
+    for (std::size_t i = 0; i < stream.points.size(); i++) {
+        const auto &point = stream.points[i];
+        bool ordered = i == 0 || std::tie(stream.points[i - 1].frame, stream.points[i - 1].track)
+            < std::tie(point.frame, point.track);
+        if (point.frame >= stream.n_frames || point.track >= stream.n_tracks || !ordered) {
+            throw std::runtime_error(std::format("{} is corrupt", path.string()));
+        }
+    }
+    return stream;
+}
+
+}
@@ -0,0 +1,176 @@
+#include "audio/peaks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <numbers>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "audio/thread_pool.hpp"
+
+namespace audio {
+
+namespace {
+
+// a local maximum, with where interpolation put it
+struct candidate {
+    uint32_t bin;
+    double delta; // offset from the bin, in bins
+    double freq;
+    double amplitude;
+};
+
+}
+
+// vertex of the parabola through (-1, a), (0, b), (1, c), as (offset, height), for b >= a, c and b > min(a, c)
+static std::pair<double, double> parabola_top(double a, double b, double c) {
+    double delta = 0.5 * (a - c) / (a - 2 * b + c);
+    delta = std::clamp(delta, -0.5, 0.5);
+    return {delta, b - 0.25 * (a - c) * delta};
+}
+
+/**
+ * shared by all the overloads, bins are read through freq_of(i), amplitude_of(i) and phase_of(i) so the phases of
+ * a spectrogram only get worked out for the peaks
+ */
+template <typename T, typename Freq, typename Amplitude, typename Phase>
+static std::vector<wave_data_t<T>> select_peaks(uint32_t n, const Freq &freq_of, const Amplitude &amplitude_of,
+    const Phase &phase_of, uint32_t k, double min_separation, peak_interpolation interpolation) {
+    if (k == 0 || n == 0) {
+        return {};
+    }
+
+    std::vector<candidate> candidates;
+    for (uint32_t i = 0; i < n; i++) {
+        double b = amplitude_of(i);
+        double a = i > 0 ? amplitude_of(i - 1) : -1;
+        double c = i + 1 < n ? amplitude_of(i + 1) : -1;
+        if (!(b > 0 && b > a && b >= c)) {
+            continue;
+        }
+
+        candidate peak{i, 0, double(freq_of(i)), b};
+        if (interpolation != peak_interpolation::none && i > 0 && i + 1 < n) {
+            if (interpolation == peak_interpolation::gaussian && a > 0 && c > 0) {
+                auto [delta, top] = parabola_top(std::log(a), std::log(b), std::log(c));
+                peak.delta = delta;
+                peak.amplitude = std::exp(top);
+            } else {
+                // also where gaussian would take the log of 0
+                std::tie(peak.delta, peak.amplitude) = parabola_top(a, b, c);
+            }
+            double spacing = peak.delta >= 0 ? freq_of(i + 1) - freq_of(i) : freq_of(i) - freq_of(i - 1);
+            peak.freq += peak.delta * spacing;
+        }
+        candidates.push_back(peak);
+    }
+
+    if (min_separation > 0 && candidates.size() > 1) {
+        // a peak stays if it beats everything within min_separation below it and ties or beats everything above,
+        // found with a sliding window max (a deque of decreasing amplitudes) from each side
+        std::vector<char> keep(candidates.size(), 1);
+        std::deque<std::size_t> window;
+        for (std::size_t j = 0; j < candidates.size(); j++) {
+            while (!window.empty() && candidates[window.front()].freq < candidates[j].freq - min_separation) {
+                window.pop_front();
+            }
+            if (!window.empty() && candidates[window.front()].amplitude >= candidates[j].amplitude) {
+                keep[j] = 0;
+            }
+            while (!window.empty() && candidates[window.back()].amplitude <= candidates[j].amplitude) {
+                window.pop_back();
+            }
+            window.push_back(j);
+        }
+        window.clear();
+        for (std::size_t j = candidates.size(); j-- > 0;) {
+            while (!window.empty() && candidates[window.front()].freq > candidates[j].freq + min_separation) {
+                window.pop_front();
+            }
+            if (!window.empty() && candidates[window.front()].amplitude > candidates[j].amplitude) {
+                keep[j] = 0;
+            }
+            while (!window.empty() && candidates[window.back()].amplitude <= candidates[j].amplitude) {
+                window.pop_back();
+            }
+            window.push_back(j);
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t j = 0; j < candidates.size(); j++) {
+            if (keep[j]) {
+                candidates[kept++] = candidates[j];
+            }
+        }
+        candidates.resize(kept);
+    }
+
+    auto louder = [](const candidate &a, const candidate &b) {
+        return a.amplitude > b.amplitude;
+    };
+    if (candidates.size() > k) {
+        std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), louder);
+        candidates.resize(k);
+    }
+    std::sort(candidates.begin(), candidates.end(), louder);
+
+    std::vector<wave_data_t<T>> peaks(candidates.size());
+    for (std::size_t j = 0; j < candidates.size(); j++) {
+        const auto &peak = candidates[j];
+        double phase = std::remainder(double(phase_of(peak.bin)) - std::numbers::pi * peak.delta,
+            2 * std::numbers::pi);
+        peaks[j] = {static_cast<T>(peak.freq), static_cast<T>(peak.amplitude), static_cast<T>(phase)};
+    }
+    return peaks;
+}
+
+template <std::floating_point T>
+std::vector<wave_data_t<T>> find_peaks(const std::vector<wave_data_t<T>> &spectrum, uint32_t k,
+    double min_separation, peak_interpolation interpolation) {
+    return select_peaks<T>(uint32_t(spectrum.size()),
+        [&](uint32_t i) { return spectrum[i].freq; },
+        [&](uint32_t i) { return spectrum[i].amplitude; },
+        [&](uint32_t i) { return spectrum[i].phase; },
+        k, min_separation, interpolation);
+}
+
+template <std::floating_point T>
+std::vector<wave_data_t<T>> find_peaks(const spectrogram<T> &waves, uint32_t frame, uint32_t k,
+    double min_separation, peak_interpolation interpolation) {
+    const T *freqs = waves.freqs().data(), *amplitudes = waves.amplitudes(frame);
+    return select_peaks<T>(waves.n_freq(),
+        [&](uint32_t i) { return freqs[i]; },
+        [&](uint32_t i) { return amplitudes[i]; },
+        [&](uint32_t i) { return waves.phase(frame, i); },
+        k, min_separation, interpolation);
+}
+
+template <std::floating_point T>
+std::vector<std::vector<wave_data_t<T>>> find_peaks(const stft_result<T> &result, uint32_t k,
+    double min_separation, peak_interpolation interpolation, uint32_t n_threads) {
+    std::vector<std::vector<wave_data_t<T>>> peaks(result.n_signals);
+    thread_pool::global().parallel_for(result.n_signals, 4, [&](std::size_t begin, std::size_t end, unsigned) {
+        for (std::size_t s = begin; s < end; s++) {
+            peaks[s] = find_peaks(result.waves, uint32_t(s), k, min_separation, interpolation);
+        }
+    }, n_threads);
+    return peaks;
+}
+
+template std::vector<wave_dataf> find_peaks<float>(const std::vector<wave_dataf> &, uint32_t, double,
+    peak_interpolation);
+template std::vector<wave_data> find_peaks<double>(const std::vector<wave_data> &, uint32_t, double,
+    peak_interpolation);
+template std::vector<wave_dataf> find_peaks<float>(const spectrogram<float> &, uint32_t, uint32_t, double,
+    peak_interpolation);
+template std::vector<wave_data> find_peaks<double>(const spectrogram<double> &, uint32_t, uint32_t, double,
+    peak_interpolation);
+template std::vector<std::vector<wave_dataf>> find_peaks<float>(const stft_result<float> &, uint32_t, double,
+    peak_interpolation, uint32_t);
+template std::vector<std::vector<wave_data>> find_peaks<double>(const stft_result<double> &, uint32_t, double,
+    peak_interpolation, uint32_t);
+
+}
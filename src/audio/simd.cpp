@@ -0,0 +1,346 @@
+#include "audio/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numbers>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AUDIO_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace audio::simd {
+
+const char *isa_name(isa level) {
+    switch (level) {
+    case isa::scalar: return "scalar";
+    case isa::sse2:   return "sse2";
+    case isa::avx2:   return "avx2";
+    case isa::avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+namespace scalar {
+
+// one complex number per "register", this is the reference every other level gets checked against
+template <typename T>
+struct traits {
+    using C = std::complex<T>;
+    using R = T;
+    using reg = C;
+    static constexpr std::size_t width = 1;
+
+    static reg load(const C *p) { return *p; }
+    static void store(C *p, reg a) { *p = a; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+    static reg scale(reg a, R s) { return a * s; }
+    static reg neg_i(reg a) { return {a.imag(), -a.real()}; }
+    static reg set1(R s) { return {s, s}; }
+    static reg load_real(const R *p) { return {p[0], p[1]}; }
+    static reg load_float(const float *p) { return {p[0], p[1]}; }
+    static void store_real(R *p, reg a) { p[0] = a.real(); p[1] = a.imag(); }
+    static reg mul_real(reg a, reg b) { return {a.real() * b.real(), a.imag() * b.imag()}; }
+};
+
+#include "simd_kernels.inl"
+
+}
+
+#ifdef AUDIO_SIMD_X86
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+namespace sse2 {
+
+// one complex double per register
+struct traits_d {
+    using C = std::complex<double>;
+    using R = double;
+    using reg = __m128d;
+    static constexpr std::size_t width = 1;
+
+    static reg load(const C *p) { return _mm_loadu_pd(reinterpret_cast<const double *>(p)); }
+    static void store(C *p, reg a) { _mm_storeu_pd(reinterpret_cast<double *>(p), a); }
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+    static reg mul(reg a, reg b) {
+        // (ar br, ai br) + (-ai bi, ar bi), no addsub without sse3
+        reg re = _mm_unpacklo_pd(b, b), im = _mm_unpackhi_pd(b, b);
+        reg swapped = _mm_shuffle_pd(a, a, 1);
+        return _mm_add_pd(_mm_mul_pd(a, re), _mm_xor_pd(_mm_mul_pd(swapped, im), _mm_set_pd(0., -0.)));
+    }
+    static reg scale(reg a, R s) { return _mm_mul_pd(a, _mm_set1_pd(s)); }
+    static reg neg_i(reg a) { return _mm_xor_pd(_mm_shuffle_pd(a, a, 1), _mm_set_pd(-0., 0.)); }
+    static reg set1(R s) { return _mm_set1_pd(s); }
+    static reg load_real(const R *p) { return _mm_loadu_pd(p); }
+    static reg load_float(const float *p) {
+        return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(p))));
+    }
+    static void store_real(R *p, reg a) { _mm_storeu_pd(p, a); }
+    static reg mul_real(reg a, reg b) { return _mm_mul_pd(a, b); }
+};
+
+// two complex floats per register
+struct traits_f {
+    using C = std::complex<float>;
+    using R = float;
+    using reg = __m128;
+    static constexpr std::size_t width = 2;
+
+    static reg load(const C *p) { return _mm_loadu_ps(reinterpret_cast<const float *>(p)); }
+    static void store(C *p, reg a) { _mm_storeu_ps(reinterpret_cast<float *>(p), a); }
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static reg mul(reg a, reg b) {
+        // same as the double one, with pairs of lanes
+        reg re = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0)), im = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+        reg swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_add_ps(_mm_mul_ps(a, re), _mm_xor_ps(_mm_mul_ps(swapped, im), _mm_set_ps(0.f, -0.f, 0.f, -0.f)));
+    }
+    static reg scale(reg a, R s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+    static reg neg_i(reg a) {
+        return _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(-0.f, 0.f, -0.f, 0.f));
+    }
+    static reg set1(R s) { return _mm_set1_ps(s); }
+    static reg load_real(const R *p) { return _mm_loadu_ps(p); }
+    static reg load_float(const float *p) { return _mm_loadu_ps(p); }
+    static void store_real(R *p, reg a) { _mm_storeu_ps(p, a); }
+    static reg mul_real(reg a, reg b) { return _mm_mul_ps(a, b); }
+};
+
+#include "simd_kernels.inl"
+
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+namespace avx2 {
+
+// two complex doubles per register
+struct traits_d {
+    using C = std::complex<double>;
+    using R = double;
+    using reg = __m256d;
+    static constexpr std::size_t width = 2;
+
+    static reg load(const C *p) { return _mm256_loadu_pd(reinterpret_cast<const double *>(p)); }
+    static void store(C *p, reg a) { _mm256_storeu_pd(reinterpret_cast<double *>(p), a); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b) {
+        // even lanes a b_re - swap(a) b_im, odd lanes a b_re + swap(a) b_im
+        reg swapped = _mm256_permute_pd(a, 0x5);
+        return _mm256_fmaddsub_pd(a, _mm256_movedup_pd(b), _mm256_mul_pd(swapped, _mm256_permute_pd(b, 0xF)));
+    }
+    static reg scale(reg a, R s) { return _mm256_mul_pd(a, _mm256_set1_pd(s)); }
+    static reg neg_i(reg a) { return _mm256_xor_pd(_mm256_permute_pd(a, 0x5), _mm256_set_pd(-0., 0., -0., 0.)); }
+    static reg set1(R s) { return _mm256_set1_pd(s); }
+    static reg load_real(const R *p) { return _mm256_loadu_pd(p); }
+    static reg load_float(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+    static void store_real(R *p, reg a) { _mm256_storeu_pd(p, a); }
+    static reg mul_real(reg a, reg b) { return _mm256_mul_pd(a, b); }
+};
+
+// four complex floats per register
+struct traits_f {
+    using C = std::complex<float>;
+    using R = float;
+    using reg = __m256;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const C *p) { return _mm256_loadu_ps(reinterpret_cast<const float *>(p)); }
+    static void store(C *p, reg a) { _mm256_storeu_ps(reinterpret_cast<float *>(p), a); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg mul(reg a, reg b) {
+        reg swapped = _mm256_permute_ps(a, 0xB1);
+        return _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(b), _mm256_mul_ps(swapped, _mm256_movehdup_ps(b)));
+    }
+    static reg scale(reg a, R s) { return _mm256_mul_ps(a, _mm256_set1_ps(s)); }
+    static reg neg_i(reg a) {
+        return _mm256_xor_ps(_mm256_permute_ps(a, 0xB1), _mm256_set_ps(-0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f));
+    }
+    static reg set1(R s) { return _mm256_set1_ps(s); }
+    static reg load_real(const R *p) { return _mm256_loadu_ps(p); }
+    static reg load_float(const float *p) { return _mm256_loadu_ps(p); }
+    static void store_real(R *p, reg a) { _mm256_storeu_ps(p, a); }
+    static reg mul_real(reg a, reg b) { return _mm256_mul_ps(a, b); }
+};
+
+#include "simd_kernels.inl"
+
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// gcc 12's avx512 headers trip this through _mm512_undefined_pd
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+namespace avx512 {
+
+// four complex doubles per register
+struct traits_d {
+    using C = std::complex<double>;
+    using R = double;
+    using reg = __m512d;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const C *p) { return _mm512_loadu_pd(reinterpret_cast<const double *>(p)); }
+    static void store(C *p, reg a) { _mm512_storeu_pd(reinterpret_cast<double *>(p), a); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b) {
+        reg swapped = _mm512_permute_pd(a, 0x55);
+        return _mm512_fmaddsub_pd(a, _mm512_movedup_pd(b), _mm512_mul_pd(swapped, _mm512_permute_pd(b, 0xFF)));
+    }
+    static reg scale(reg a, R s) { return _mm512_mul_pd(a, _mm512_set1_pd(s)); }
+    static reg neg_i(reg a) {
+        // no _mm512_xor_pd without avx512dq, so flip the sign through the integer unit
+        __m512i sign = _mm512_set_epi64(
+            INT64_MIN, 0, INT64_MIN, 0, INT64_MIN, 0, INT64_MIN, 0);
+        return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(_mm512_permute_pd(a, 0x55)), sign));
+    }
+    static reg set1(R s) { return _mm512_set1_pd(s); }
+    static reg load_real(const R *p) { return _mm512_loadu_pd(p); }
+    static reg load_float(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+    static void store_real(R *p, reg a) { _mm512_storeu_pd(p, a); }
+    static reg mul_real(reg a, reg b) { return _mm512_mul_pd(a, b); }
+};
+
+// eight complex floats per register
+struct traits_f {
+    using C = std::complex<float>;
+    using R = float;
+    using reg = __m512;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const C *p) { return _mm512_loadu_ps(reinterpret_cast<const float *>(p)); }
+    static void store(C *p, reg a) { _mm512_storeu_ps(reinterpret_cast<float *>(p), a); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg mul(reg a, reg b) {
+        reg swapped = _mm512_permute_ps(a, 0xB1);
+        return _mm512_fmaddsub_ps(a, _mm512_moveldup_ps(b), _mm512_mul_ps(swapped, _mm512_movehdup_ps(b)));
+    }
+    static reg scale(reg a, R s) { return _mm512_mul_ps(a, _mm512_set1_ps(s)); }
+    static reg neg_i(reg a) {
+        // the odd floats are the high halves of 64 bit lanes, so their sign bits are those lanes' sign bits
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_permute_ps(a, 0xB1)),
+            _mm512_set1_epi64(INT64_MIN)));
+    }
+    static reg set1(R s) { return _mm512_set1_ps(s); }
+    static reg load_real(const R *p) { return _mm512_loadu_ps(p); }
+    static reg load_float(const float *p) { return _mm512_loadu_ps(p); }
+    static void store_real(R *p, reg a) { _mm512_storeu_ps(p, a); }
+    static reg mul_real(reg a, reg b) { return _mm512_mul_ps(a, b); }
+};
+
+#include "simd_kernels.inl"
+
+}
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+
+#endif // AUDIO_SIMD_X86
+
+isa detected_isa() {
+#ifdef AUDIO_SIMD_X86
+    static const isa level = []{
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return isa::avx512;
+        } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return isa::avx2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            return isa::sse2;
+        }
+        return isa::scalar;
+    }();
+    return level;
+#else
+    return isa::scalar;
+#endif
+}
+
+isa selected_isa() {
+    static const isa level = []{
+        isa detected = detected_isa();
+        const char *env = std::getenv("AUDIO_SIMD");
+        if (!env || !*env) {
+            return detected;
+        }
+
+        for (isa requested : {isa::scalar, isa::sse2, isa::avx2, isa::avx512}) {
+            if (std::string_view(env) == isa_name(requested)) {
+                if (requested > detected) {
+                    std::cerr << "AUDIO_SIMD=" << env << " is not supported by this cpu, using "
+                        << isa_name(detected) << '\n';
+                    return detected;
+                }
+                return requested;
+            }
+        }
+
+        std::cerr << "Unrecognized AUDIO_SIMD=" << env << ", using " << isa_name(detected) << '\n';
+        return detected;
+    }();
+    return level;
+}
+
+template <>
+const kernels<double> &kernels_for<double>(isa level) {
+    static const kernels<double> scalar_k = scalar::make_kernels<scalar::traits<double>>(isa::scalar);
+#ifdef AUDIO_SIMD_X86
+    static const kernels<double> sse2_k   = sse2::make_kernels<sse2::traits_d>(isa::sse2);
+    static const kernels<double> avx2_k   = avx2::make_kernels<avx2::traits_d>(isa::avx2);
+    static const kernels<double> avx512_k = avx512::make_kernels<avx512::traits_d>(isa::avx512);
+
+    switch (std::min(level, detected_isa())) {
+    case isa::avx512: return avx512_k;
+    case isa::avx2:   return avx2_k;
+    case isa::sse2:   return sse2_k;
+    case isa::scalar: break;
+    }
+#endif
+    return scalar_k;
+}
+
+template <>
+const kernels<float> &kernels_for<float>(isa level) {
+    static const kernels<float> scalar_k = scalar::make_kernels<scalar::traits<float>>(isa::scalar);
+#ifdef AUDIO_SIMD_X86
+    static const kernels<float> sse2_k   = sse2::make_kernels<sse2::traits_f>(isa::sse2);
+    static const kernels<float> avx2_k   = avx2::make_kernels<avx2::traits_f>(isa::avx2);
+    static const kernels<float> avx512_k = avx512::make_kernels<avx512::traits_f>(isa::avx512);
+
+    switch (std::min(level, detected_isa())) {
+    case isa::avx512: return avx512_k;
+    case isa::avx2:   return avx2_k;
+    case isa::sse2:   return sse2_k;
+    case isa::scalar: break;
+    }
+#endif
+    return scalar_k;
+}
+
+template <typename T>
+const kernels<T> &active() {
+    static const kernels<T> &k = kernels_for<T>(selected_isa());
+    return k;
+}
+
+template const kernels<float> &active<float>();
+template const kernels<double> &active<double>();
+
+}
\ No newline at end of file
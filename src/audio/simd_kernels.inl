@@ -0,0 +1,270 @@
+// kernel bodies shared by every instruction set level in simd.cpp
+// this gets included once per level, inside that level's namespace and target pragma, with V being a struct of
+// register operations:
+//     C                             complex element type
+//     R                             real element type
+//     reg                           register type
+//     width                         complex elements per register (so 2 * width reals)
+//     load(const C *), store(C *, reg)
+//     add, sub, mul (complex), scale(reg, R), neg_i (multiply by -i), set1(R)
+//     load_real(const R *), load_float(const float *) (reads 2 * width elements), store_real(R *, reg)
+//     mul_real (elementwise)
+
+template <typename V>
+void twiddle_mul(std::size_t n, typename V::C *data, const typename V::C *tw) {
+    std::size_t i = 0;
+    for (; i + V::width <= n; i += V::width) {
+        V::store(data + i, V::mul(V::load(data + i), V::load(tw + i)));
+    }
+    for (; i < n; i++) {
+        data[i] *= tw[i];
+    }
+}
+
+template <typename V>
+void complex_mac(std::size_t n, typename V::C *acc, const typename V::C *a, const typename V::C *b) {
+    std::size_t i = 0;
+    for (; i + V::width <= n; i += V::width) {
+        V::store(acc + i, V::add(V::load(acc + i), V::mul(V::load(a + i), V::load(b + i))));
+    }
+    for (; i < n; i++) {
+        acc[i] += a[i] * b[i];
+    }
+}
+
+template <typename V>
+void butterfly2(std::size_t m, typename V::C *data) {
+    using C = typename V::C;
+    C *r0 = data, *r1 = data + m;
+    std::size_t k = 0;
+    for (; k + V::width <= m; k += V::width) {
+        auto a = V::load(r0 + k), b = V::load(r1 + k);
+        V::store(r0 + k, V::add(a, b));
+        V::store(r1 + k, V::sub(a, b));
+    }
+    for (; k < m; k++) {
+        C a = r0[k], b = r1[k];
+        r0[k] = a + b;
+        r1[k] = a - b;
+    }
+}
+
+template <typename V>
+void butterfly3(std::size_t m, typename V::C *data) {
+    using C = typename V::C;
+    using R = typename V::R;
+    constexpr R s60 = std::numbers::sqrt3_v<R> / 2;
+    C *r0 = data, *r1 = data + m, *r2 = data + 2 * m;
+    std::size_t k = 0;
+    auto half = V::set1(R(0.5));
+    for (; k + V::width <= m; k += V::width) {
+        auto a = V::load(r0 + k), b = V::load(r1 + k), c = V::load(r2 + k);
+        auto sum = V::add(b, c);
+        auto t = V::sub(a, V::mul_real(sum, half));
+        auto u = V::neg_i(V::scale(V::sub(b, c), s60));
+        V::store(r0 + k, V::add(a, sum));
+        V::store(r1 + k, V::add(t, u));
+        V::store(r2 + k, V::sub(t, u));
+    }
+    for (; k < m; k++) {
+        C a = r0[k], b = r1[k], c = r2[k];
+        C sum = b + c;
+        C t = a - sum * R(0.5);
+        C diff = (b - c) * s60;
+        C u(diff.imag(), -diff.real());
+        r0[k] = a + sum;
+        r1[k] = t + u;
+        r2[k] = t - u;
+    }
+}
+
+template <typename V>
+void butterfly4(std::size_t m, typename V::C *data) {
+    using C = typename V::C;
+    C *r0 = data, *r1 = data + m, *r2 = data + 2 * m, *r3 = data + 3 * m;
+    std::size_t k = 0;
+    for (; k + V::width <= m; k += V::width) {
+        auto a = V::load(r0 + k), b = V::load(r1 + k), c = V::load(r2 + k), d = V::load(r3 + k);
+        auto ac_sum = V::add(a, c), ac_diff = V::sub(a, c);
+        auto bd_sum = V::add(b, d), bd_diff_i = V::neg_i(V::sub(b, d));
+        V::store(r0 + k, V::add(ac_sum, bd_sum));
+        V::store(r1 + k, V::add(ac_diff, bd_diff_i));
+        V::store(r2 + k, V::sub(ac_sum, bd_sum));
+        V::store(r3 + k, V::sub(ac_diff, bd_diff_i));
+    }
+    for (; k < m; k++) {
+        C a = r0[k], b = r1[k], c = r2[k], d = r3[k];
+        C ac_sum = a + c, ac_diff = a - c;
+        C bd_sum = b + d, bd_diff = b - d;
+        C bd_diff_i(bd_diff.imag(), -bd_diff.real());
+        r0[k] = ac_sum + bd_sum;
+        r1[k] = ac_diff + bd_diff_i;
+        r2[k] = ac_sum - bd_sum;
+        r3[k] = ac_diff - bd_diff_i;
+    }
+}
+
+template <typename V>
+void butterfly5(std::size_t m, typename V::C *data) {
+    using C = typename V::C;
+    using R = typename V::R;
+    const R c1 = std::cos(2 * std::numbers::pi_v<R> / 5), c2 = std::cos(4 * std::numbers::pi_v<R> / 5);
+    const R s1 = std::sin(2 * std::numbers::pi_v<R> / 5), s2 = std::sin(4 * std::numbers::pi_v<R> / 5);
+    C *r0 = data, *r1 = data + m, *r2 = data + 2 * m, *r3 = data + 3 * m, *r4 = data + 4 * m;
+    std::size_t k = 0;
+    for (; k + V::width <= m; k += V::width) {
+        auto a = V::load(r0 + k), b = V::load(r1 + k), c = V::load(r2 + k), d = V::load(r3 + k), e = V::load(r4 + k);
+        auto t1 = V::add(b, e), t2 = V::add(c, d), t3 = V::sub(b, e), t4 = V::sub(c, d);
+        auto x1 = V::add(a, V::add(V::scale(t1, c1), V::scale(t2, c2)));
+        auto x2 = V::add(a, V::add(V::scale(t1, c2), V::scale(t2, c1)));
+        auto iy1 = V::neg_i(V::add(V::scale(t3, s1), V::scale(t4, s2)));
+        auto iy2 = V::neg_i(V::sub(V::scale(t3, s2), V::scale(t4, s1)));
+        V::store(r0 + k, V::add(a, V::add(t1, t2)));
+        V::store(r1 + k, V::add(x1, iy1));
+        V::store(r2 + k, V::add(x2, iy2));
+        V::store(r3 + k, V::sub(x2, iy2));
+        V::store(r4 + k, V::sub(x1, iy1));
+    }
+    for (; k < m; k++) {
+        C a = r0[k], b = r1[k], c = r2[k], d = r3[k], e = r4[k];
+        C t1 = b + e, t2 = c + d, t3 = b - e, t4 = c - d;
+        C x1 = a + c1 * t1 + c2 * t2, x2 = a + c2 * t1 + c1 * t2;
+        C y1 = s1 * t3 + s2 * t4, y2 = s2 * t3 - s1 * t4;
+        C iy1(y1.imag(), -y1.real()), iy2(y2.imag(), -y2.real());
+        r0[k] = a + t1 + t2;
+        r1[k] = x1 + iy1;
+        r2[k] = x2 + iy2;
+        r3[k] = x2 - iy2;
+        r4[k] = x1 - iy1;
+    }
+}
+
+template <typename V>
+void window_apply(std::size_t n, const float *input, std::size_t in_spacing, const typename V::R *window,
+    typename V::R *output) {
+    using R = typename V::R;
+    std::size_t i = 0;
+    if (in_spacing == 1) {
+        if (window) {
+            for (; i + 2 * V::width <= n; i += 2 * V::width) {
+                V::store_real(output + i, V::mul_real(V::load_float(input + i), V::load_real(window + i)));
+            }
+        } else {
+            for (; i + 2 * V::width <= n; i += 2 * V::width) {
+                V::store_real(output + i, V::load_float(input + i));
+            }
+        }
+    }
+    for (; i < n; i++) {
+        output[i] = static_cast<R>(input[i * in_spacing]) * (window ? window[i] : R(1));
+    }
+}
+
+template <typename V>
+void goertzel(std::size_t n, const float *input, std::size_t in_spacing, const typename V::R *window,
+    std::size_t n_freqs, const typename V::R *coeff, typename V::R *s1, typename V::R *s2) {
+    using R = typename V::R;
+    constexpr std::size_t lanes = 2 * V::width;
+    // the states stay in registers for the whole block, with a few independent groups at once to hide the latency
+    // of the recurrence. the samples get reread for every group, but they're in cache
+    constexpr std::size_t groups = 4;
+    std::size_t j = 0;
+    for (; j + lanes <= n_freqs; ) {
+        std::size_t n_groups = std::min(groups, (n_freqs - j) / lanes);
+        typename V::reg c[groups], a[groups], b[groups];
+        for (std::size_t g = 0; g < n_groups; g++) {
+            c[g] = V::load_real(coeff + j + g * lanes);
+            a[g] = V::load_real(s1 + j + g * lanes);
+            b[g] = V::load_real(s2 + j + g * lanes);
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            auto x = V::set1(static_cast<R>(input[i * in_spacing]) * (window ? window[i] : R(1)));
+            for (std::size_t g = 0; g < n_groups; g++) {
+                auto s = V::add(x, V::sub(V::mul_real(c[g], a[g]), b[g]));
+                b[g] = a[g];
+                a[g] = s;
+            }
+        }
+        for (std::size_t g = 0; g < n_groups; g++) {
+            V::store_real(s1 + j + g * lanes, a[g]);
+            V::store_real(s2 + j + g * lanes, b[g]);
+        }
+        j += n_groups * lanes;
+    }
+    for (; j < n_freqs; j++) {
+        R a = s1[j], b = s2[j];
+        for (std::size_t i = 0; i < n; i++) {
+            R s = static_cast<R>(input[i * in_spacing]) * (window ? window[i] : R(1)) + coeff[j] * a - b;
+            b = a;
+            a = s;
+        }
+        s1[j] = a;
+        s2[j] = b;
+    }
+}
+
+template <typename V>
+void oscillate(std::size_t n, std::size_t n_partials, const typename V::R *z_re, const typename V::R *z_im,
+    const typename V::R *step_re, const typename V::R *step_im, typename V::R *output) {
+    using R = typename V::R;
+    using C = std::complex<R>;
+    constexpr std::size_t lanes = 2 * V::width;
+    // each register holds one partial at lanes consecutive samples, so the real parts add straight into the output
+    // and the whole register steps forward by step^lanes. a few partials go at once to share the output loads
+    constexpr std::size_t group = 4;
+    std::size_t n_vec = n - n % lanes;
+    for (std::size_t j = 0; j < n_partials; j += group) {
+        std::size_t n_group = std::min(group, n_partials - j);
+        typename V::reg re[group], im[group], leap_re[group], leap_im[group];
+        for (std::size_t g = 0; g < n_group; g++) {
+            C step(step_re[j + g], step_im[j + g]), z(z_re[j + g], z_im[j + g]), leap = 1;
+            R lane_re[lanes], lane_im[lanes];
+            for (std::size_t k = 0; k < lanes; k++) {
+                lane_re[k] = (z * leap).real();
+                lane_im[k] = (z * leap).imag();
+                leap *= step;
+            }
+            re[g] = V::load_real(lane_re);
+            im[g] = V::load_real(lane_im);
+            leap_re[g] = V::set1(leap.real());
+            leap_im[g] = V::set1(leap.imag());
+        }
+
+        std::size_t i = 0;
+        for (; i < n_vec; i += lanes) {
+            auto sum = V::load_real(output + i);
+            for (std::size_t g = 0; g < n_group; g++) {
+                sum = V::add(sum, re[g]);
+                auto next_re = V::sub(V::mul_real(re[g], leap_re[g]), V::mul_real(im[g], leap_im[g]));
+                im[g] = V::add(V::mul_real(re[g], leap_im[g]), V::mul_real(im[g], leap_re[g]));
+                re[g] = next_re;
+            }
+            V::store_real(output + i, sum);
+        }
+
+        // the last few samples, the registers are sitting at sample n_vec
+        for (std::size_t g = 0; g < n_group; g++) {
+            R lane_re[lanes];
+            V::store_real(lane_re, re[g]);
+            for (std::size_t k = 0; i + k < n; k++) {
+                output[i + k] += lane_re[k];
+            }
+        }
+    }
+}
+
+template <typename V>
+kernels<typename V::R> make_kernels(isa level) {
+    return {
+        level,
+        twiddle_mul<V>,
+        complex_mac<V>,
+        butterfly2<V>,
+        butterfly3<V>,
+        butterfly4<V>,
+        butterfly5<V>,
+        window_apply<V>,
+        goertzel<V>,
+        oscillate<V>,
+    };
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "audio/sliding_dft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "audio/table_cache.hpp"
+
+namespace audio {
+
+sliding_dft::sliding_dft(uint32_t samples_per_sec, uint32_t n_window_size, std::vector<uint32_t> bins,
+    const window &win)
+    : samples_per_sec_{samples_per_sec}, n_{n_window_size}, bins_{std::move(bins)}, pos_{0}, n_samples_{0} {
+    if (n_ == 0) {
+        throw std::invalid_argument("sliding_dft needs a nonzero window size");
+    }
+    for (auto k : bins_) {
+        if (k > (n_ - 1) / 2) {
+            throw std::invalid_argument("sliding_dft bin out of range");
+        }
+    }
+    auto terms = cosine_sum_terms(win);
+    if (terms.empty()) {
+        throw std::invalid_argument("sliding_dft can only apply cosine sum windows");
+    }
+
+    roots_ = table_cache::global().get<std::complex<double>>(table_kind::dft_roots, n_, 0, [n = n_]{
+        std::vector<std::complex<double>> roots(n);
+        for (uint32_t k = 0; k < n; k++) {
+            roots[k] = std::polar(1., -2 * std::numbers::pi * k / n);
+        }
+        return roots;
+    });
+
+    // the window multiplies the samples by a_0 - a_1 cos(2πj/n) + ..., and each cos(2πmj/n) is half a shift of m bins
+    // each way, so windowed bin k is a_0 X(k) - a_1/2 (X(k - 1) + X(k + 1)) + a_2/2 (X(k - 2) + X(k + 2)) - ...
+    int32_t reach = int32_t(terms.size()) - 1;
+    term_offset_.push_back(0);
+    for (auto k : bins_) {
+        for (int32_t m = -reach; m <= reach; m++) {
+            auto bin = uint32_t(((int64_t(k) + m) % n_ + n_) % n_);
+            auto a = terms[std::abs(m)];
+            double weight = m == 0 ? a : (std::abs(m) % 2 ? -a : a) / 2;
+
+            auto found = std::find(tracked_.begin(), tracked_.end(), bin);
+            if (found == tracked_.end()) {
+                tracked_.push_back(bin);
+                found = tracked_.end() - 1;
+            }
+            term_bin_.push_back(uint32_t(found - tracked_.begin()));
+            term_weight_.push_back(weight);
+        }
+        term_offset_.push_back(uint32_t(term_bin_.size()));
+    }
+
+    // same correction as naive_ft, the window's coefficients sum to a_0 n
+    amp_scale_ = 2 / (terms[0] * n_);
+
+    phase_.resize(tracked_.size());
+    sum_re_.resize(tracked_.size());
+    sum_im_.resize(tracked_.size());
+    history_.resize(n_);
+    reset();
+}
+
+void sliding_dft::reset() {
+    std::fill(phase_.begin(), phase_.end(), 0);
+    std::fill(sum_re_.begin(), sum_re_.end(), 0.);
+    std::fill(sum_im_.begin(), sum_im_.end(), 0.);
+    std::fill(history_.begin(), history_.end(), 0.f);
+    pos_ = 0;
+    n_samples_ = 0;
+}
+
+void sliding_dft::push(float sample) {
+    // the sample leaving the window had the same twiddle as the one coming in (they're n apart),
+    // so both are handled with one multiply
+    double delta = static_cast<double>(sample) - history_[pos_];
+    history_[pos_] = sample;
+
+    const auto *roots = roots_->data();
+    std::size_t n_tracked = tracked_.size();
+    for (std::size_t j = 0; j < n_tracked; j++) {
+        auto root = roots[phase_[j]];
+        sum_re_[j] += delta * root.real();
+        sum_im_[j] += delta * root.imag();
+        phase_[j] += tracked_[j];
+        if (phase_[j] >= n_) {
+            phase_[j] -= n_;
+        }
+    }
+
+    if (++pos_ == n_) {
+        pos_ = 0;
+    }
+    n_samples_++;
+}
+
+void sliding_dft::push(uint32_t n_samples, const float *input, uint32_t in_spacing) {
+    for (uint32_t i = 0; i < n_samples; i++) {
+        push(input[std::size_t(i) * in_spacing]);
+    }
+}
+
+void sliding_dft::waves(wave_data *out) const {
+    // the sums are relative to sample 0 of the whole signal, rotating by e^(2πik(n_samples)/n) (the conjugate of
+    // the next twiddle) moves them to the start of the window
+    const auto *roots = roots_->data();
+    for (std::size_t i = 0; i < bins_.size(); i++) {
+        std::complex<double> bin = 0;
+        for (uint32_t t = term_offset_[i]; t < term_offset_[i + 1]; t++) {
+            auto j = term_bin_[t];
+            bin += term_weight_[t] * std::complex<double>(sum_re_[j], sum_im_[j]) * std::conj(roots[phase_[j]]);
+        }
+
+        out[i] = {static_cast<double>(bins_[i]) * samples_per_sec_ / n_, std::abs(bin) * amp_scale_, std::arg(bin)};
+        if (bins_[i] == 0) {
+            out[i].amplitude /= 2; // same as naive_ft, 0 Hz doesn't have a negative twin
+        }
+    }
+}
+
+std::vector<wave_data> sliding_dft::waves() const {
+    std::vector<wave_data> out(bins_.size());
+    waves(out.data());
+    return out;
+}
+
+void sliding_dft::resync() {
+    const auto *roots = roots_->data();
+    for (std::size_t j = 0; j < tracked_.size(); j++) {
+        double re = 0, im = 0;
+        uint32_t phase = 0; // tracked_[j] * p mod n
+        for (uint32_t p = 0; p < n_; p++) {
+            re += history_[p] * roots[phase].real();
+            im += history_[p] * roots[phase].imag();
+            phase += tracked_[j];
+            if (phase >= n_) {
+                phase -= n_;
+            }
+        }
+        sum_re_[j] = re;
+        sum_im_[j] = im;
+    }
+}
+
+}
@@ -0,0 +1,214 @@
+#include "audio/spectrogram_file.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace audio {
+
+static uint64_t round_up(uint64_t n, uint64_t multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+template <std::floating_point T>
+stft_file_writer<T>::stft_file_writer(const std::filesystem::path &path, std::vector<T> freqs, T freq_delta,
+    uint32_t samples_per_sec, uint32_t n_window_offset, uint32_t n_window_size, const window &win)
+    : file_(path, std::ios::binary | std::ios::trunc), header_{} {
+    if (!file_) {
+        throw std::runtime_error(std::format("couldn't open {} for writing", path.string()));
+    }
+
+    std::copy_n(spectrogram_file_header::expected_magic, 8, header_.magic);
+    header_.version = 0; // until finish(), so unfinished files don't open
+    header_.value_size = sizeof(T);
+    header_.n_freq = uint32_t(freqs.size());
+    header_.samples_per_sec = samples_per_sec;
+    header_.n_window_size = n_window_size;
+    header_.n_window_offset = n_window_offset;
+    header_.window_type = uint32_t(win.type);
+    header_.window_param = win.param;
+    header_.freq_delta = freq_delta;
+    header_.time_delta = samples_per_sec > 0 ? static_cast<double>(n_window_offset) / samples_per_sec : 0.;
+    header_.row_size = spectrogram<T>::aligned_stride(header_.n_freq);
+    header_.freqs_offset = round_up(sizeof(spectrogram_file_header), alignof(std::max_align_t));
+    header_.frames_offset = round_up(header_.freqs_offset + freqs.size() * sizeof(T),
+        spectrogram_file_header::page_size);
+
+    // header, frequencies and zeros up to the first frame
+    std::vector<char> start(header_.frames_offset, 0);
+    std::memcpy(start.data(), &header_, sizeof(header_));
+    std::memcpy(start.data() + header_.freqs_offset, freqs.data(), freqs.size() * sizeof(T));
+    file_.write(start.data(), std::streamsize(start.size()));
+    if (!file_) {
+        throw std::runtime_error(std::format("couldn't write to {}", path.string()));
+    }
+
+    record_.assign(3 * header_.row_size, T(0));
+}
+
+template <std::floating_point T>
+void stft_file_writer<T>::write(const T *re, const T *im) {
+    T *re_row = record_.data(), *im_row = re_row + header_.row_size, *amplitude_row = im_row + header_.row_size;
+    for (uint32_t k = 0; k < header_.n_freq; k++) {
+        re_row[k] = re[k];
+        im_row[k] = im[k];
+        amplitude_row[k] = std::sqrt(re[k] * re[k] + im[k] * im[k]);
+    }
+    file_.write(reinterpret_cast<const char *>(record_.data()), std::streamsize(record_.size() * sizeof(T)));
+    if (!file_) {
+        throw std::runtime_error("couldn't write spectrogram frame");
+    }
+    header_.n_signals++;
+}
+
+template <std::floating_point T>
+void stft_file_writer<T>::write(std::span<const wave_data> waves) {
+    T *re_row = record_.data(), *im_row = re_row + header_.row_size, *amplitude_row = im_row + header_.row_size;
+    for (uint32_t k = 0; k < header_.n_freq; k++) {
+        re_row[k] = static_cast<T>(waves[k].amplitude * std::cos(waves[k].phase));
+        im_row[k] = static_cast<T>(waves[k].amplitude * std::sin(waves[k].phase));
+        amplitude_row[k] = static_cast<T>(waves[k].amplitude);
+    }
+    file_.write(reinterpret_cast<const char *>(record_.data()), std::streamsize(record_.size() * sizeof(T)));
+    if (!file_) {
+        throw std::runtime_error("couldn't write spectrogram frame");
+    }
+    header_.n_signals++;
+}
+
+template <std::floating_point T>
+void stft_file_writer<T>::finish(uint32_t n_samples) {
+    header_.n_samples = n_samples;
+    // an empty result (e.g. naive_stft's for a signal shorter than the window) has no offset to divide by
+    bool empty = header_.n_signals == 0 || header_.n_window_offset == 0 || n_samples < header_.n_window_size;
+    header_.n_full_signals = empty ? 0
+        : std::min(header_.n_signals, (n_samples - header_.n_window_size) / header_.n_window_offset + 1);
+    header_.version = spectrogram_file_header::current_version;
+
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("couldn't finish spectrogram file");
+    }
+}
+
+template struct stft_file_writer<float>;
+template struct stft_file_writer<double>;
+
+template <std::floating_point T>
+void write_stft_to_file(const std::filesystem::path &path, const stft_result<T> &result) {
+    stft_file_writer<T> writer(path, result.waves.freqs(), result.freq_delta, result.samples_per_sec,
+        result.n_window_offset, result.n_window_size, result.win);
+    for (uint32_t s = 0; s < result.n_signals; s++) {
+        writer.write(result.waves.re(s), result.waves.im(s));
+    }
+    writer.finish(result.n_samples);
+}
+
+namespace {
+
+// a read-only mapping of a whole file, unmapped when the last spectrogram borrowing from it goes away
+struct file_mapping {
+    explicit file_mapping(const std::filesystem::path &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error(std::format("couldn't open {}", path.string()));
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size < off_t(sizeof(spectrogram_file_header))) {
+            ::close(fd);
+            throw std::runtime_error(std::format("{} is too short to be a spectrogram file", path.string()));
+        }
+        size = std::size_t(info.st_size);
+        data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file open
+        if (data == MAP_FAILED) {
+            throw std::runtime_error(std::format("couldn't map {}", path.string()));
+        }
+    }
+    file_mapping(const file_mapping &) = delete;
+    file_mapping &operator=(const file_mapping &) = delete;
+    ~file_mapping() {
+        ::munmap(data, size);
+    }
+
+    void *data;
+    std::size_t size;
+};
+
+}
+
+template <std::floating_point T>
+stft_result<T> map_stft_from_file(const std::filesystem::path &path) {
+    auto mapping = std::make_shared<const file_mapping>(path);
+    const char *bytes = static_cast<const char *>(mapping->data);
+
+    spectrogram_file_header header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, spectrogram_file_header::expected_magic, 8) != 0) {
+        throw std::runtime_error(std::format("{} isn't a spectrogram file", path.string()));
+    }
+    if (header.version != spectrogram_file_header::current_version) {
+        throw std::runtime_error(std::format("{} has version {}, expected {} (or it was never finished)",
+            path.string(), header.version, spectrogram_file_header::current_version));
+    }
+    if (header.value_size != sizeof(T)) {
+        throw std::runtime_error(std::format("{} holds {} byte values, asked for {} byte ones", path.string(),
+            header.value_size, sizeof(T)));
+    }
+    // every size is checked against what's left of the file after the offset, so a crafted header can't overflow
+    // its way past the checks
+    uint64_t size = mapping->size;
+    uint64_t record_bytes = header.row_size <= size ? 3 * header.row_size * sizeof(T) : 0;
+    if (header.row_size < header.n_freq || header.row_size > size
+        || header.frames_offset % spectrogram_file_header::page_size != 0 || header.freqs_offset % sizeof(T) != 0
+        || header.freqs_offset > size || uint64_t(header.n_freq) * sizeof(T) > size - header.freqs_offset
+        || header.frames_offset > size
+        || (record_bytes > 0 && header.n_signals > (size - header.frames_offset) / record_bytes)) {
+        throw std::runtime_error(std::format("{} is truncated or corrupt", path.string()));
+    }
+
+    auto freqs_first = reinterpret_cast<const T *>(bytes + header.freqs_offset);
+    std::vector<T> freqs(freqs_first, freqs_first + header.n_freq);
+    auto frames = reinterpret_cast<const T *>(bytes + header.frames_offset);
+    std::size_t stride = 3 * header.row_size;
+    spectrogram<T> waves(std::move(freqs), header.n_signals, stride, frames, frames + header.row_size,
+        frames + 2 * header.row_size, std::move(mapping));
+
+    auto freq_delta = static_cast<T>(header.freq_delta);
+    auto time_delta = static_cast<T>(header.time_delta);
+    return {
+        std::move(waves),
+        header.n_freq,
+        header.n_signals,
+        freq_delta,
+        freq_delta * header.n_freq, // freq_range
+        time_delta,
+        time_delta * header.n_signals, // time_range
+        header.n_full_signals,
+        header.samples_per_sec,
+        header.n_samples,
+        header.n_window_size,
+        header.n_window_offset,
+        window{static_cast<window_type>(header.window_type), header.window_param}
+    };
+}
+
+template void write_stft_to_file<float>(const std::filesystem::path &, const stft_result<float> &);
+template void write_stft_to_file<double>(const std::filesystem::path &, const stft_result<double> &);
+template stft_result<float> map_stft_from_file<float>(const std::filesystem::path &);
+template stft_result<double> map_stft_from_file<double>(const std::filesystem::path &);
+
+}
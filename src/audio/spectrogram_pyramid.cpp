@@ -0,0 +1,301 @@
+#include "audio/spectrogram_pyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace audio {
+
+// cells of a level over an axis of n bins
+static uint64_t n_cells(uint64_t n, uint32_t level) {
+    return (n + (uint64_t(1) << level) - 1) >> level;
+}
+
+// bins under cell c of a level, 2^level except for the last cell
+static uint64_t cell_length(uint64_t n, uint32_t level, uint64_t c) {
+    uint64_t first = c << level;
+    return first >= n ? 0 : std::min(uint64_t(1) << level, n - first);
+}
+
+static uint32_t n_levels(uint64_t n) {
+    uint32_t levels = 1;
+    while (n_cells(n, levels - 1) > 1) {
+        levels++;
+    }
+    return levels;
+}
+
+// coarsest level with at most one cell per pixel, when a pixel spans per_pixel bins
+static uint32_t pick_level(double per_pixel, uint32_t n_levels) {
+    if (!(per_pixel > 1)) {
+        return 0;
+    }
+    return std::min(uint32_t(std::floor(std::log2(per_pixel))), n_levels - 1);
+}
+
+template <typename T>
+spectrogram_pyramid<T>::spectrogram_pyramid(const spectrogram<T> &source, std::size_t capacity)
+    : source_{source}, n_time_levels_{n_levels(source.n_frames())}, n_freq_levels_{n_levels(source.n_freq())},
+      bytes_{0}, capacity_{capacity}, hits_{0}, misses_{0}, evictions_{0} {}
+
+template <typename T>
+std::shared_ptr<const typename spectrogram_pyramid<T>::tile> spectrogram_pyramid<T>::get(uint32_t level_t,
+    uint32_t level_f, uint32_t tile_t, uint32_t tile_f) {
+    key k{level_t, level_f, tile_t, tile_f};
+    {
+        std::lock_guard lock(mutex_);
+        if (auto it = index_.find(k); it != index_.end()) {
+            hits_++;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->value;
+        }
+        misses_++;
+    }
+
+    // built without the lock, it fetches the finer tiles through get() too
+    auto value = build(k);
+    std::size_t bytes = 2 * tile_size * tile_size * sizeof(T);
+
+    std::lock_guard lock(mutex_);
+    if (auto it = index_.find(k); it != index_.end()) {
+        // another thread built it meanwhile, keep theirs
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->value;
+    }
+    if (bytes > capacity_ || (level_t == 0 && level_f == 0)) {
+        return value; // level (0, 0) would only be a copy of the spectrogram, twice over
+    }
+    evict(capacity_ - bytes);
+    lru_.push_front({k, value});
+    index_.emplace(k, lru_.begin());
+    bytes_ += bytes;
+    return value;
+}
+
+template <typename T>
+std::shared_ptr<const typename spectrogram_pyramid<T>::tile> spectrogram_pyramid<T>::build(const key &k) {
+    constexpr uint32_t S = tile_size;
+    auto out = std::make_shared<tile>();
+    out->max.assign(S * S, 0);
+    out->mean.assign(S * S, 0);
+
+    uint64_t n_frames = source_.n_frames(), n_freq = source_.n_freq();
+    uint64_t first_t = uint64_t(k.tile_t) * S, first_f = uint64_t(k.tile_f) * S;
+    uint64_t cells_t = n_cells(n_frames, k.level_t), cells_f = n_cells(n_freq, k.level_f);
+    if (first_t >= cells_t || first_f >= cells_f) {
+        return out;
+    }
+    auto nt = uint32_t(std::min<uint64_t>(S, cells_t - first_t));
+    auto nf = uint32_t(std::min<uint64_t>(S, cells_f - first_f));
+
+    if (k.level_t == 0 && k.level_f == 0) {
+        for (uint32_t t = 0; t < nt; t++) {
+            const T *amplitudes = source_.amplitudes(uint32_t(first_t + t)) + first_f;
+            std::copy(amplitudes, amplitudes + nf, out->max.begin() + t * S);
+            std::copy(amplitudes, amplitudes + nf, out->mean.begin() + t * S);
+        }
+        return out;
+    }
+
+    // halve time first, then frequency. cell c of this level is cells 2c and 2c + 1 of the finer one, which sit in
+    // the finer level's tiles 2 * tile and 2 * tile + 1, or in the spectrogram itself when that's level (0, 0)
+    bool along_t = k.level_t > 0;
+    key finer = along_t ? key{k.level_t - 1, k.level_f, 2 * k.tile_t, k.tile_f}
+                        : key{k.level_t, k.level_f - 1, k.tile_t, 2 * k.tile_f};
+    bool from_source = finer.level_t == 0 && finer.level_f == 0;
+    uint64_t finer_cells = along_t ? n_cells(n_frames, finer.level_t) : n_cells(n_freq, finer.level_f);
+    uint64_t finer_first = 2 * (along_t ? first_t : first_f);
+    std::shared_ptr<const tile> children[2];
+    for (uint32_t half = 0; half < 2 && !from_source; half++) {
+        if (finer_first + half * S < finer_cells) {
+            key child = finer;
+            (along_t ? child.tile_t : child.tile_f) += half;
+            children[half] = get(child.level_t, child.level_f, child.tile_t, child.tile_f);
+        }
+    }
+
+    for (uint32_t t = 0; t < nt; t++) {
+        for (uint32_t f = 0; f < nf; f++) {
+            T max = 0;
+            double sum = 0, count = 0;
+            for (uint32_t j = 0; j < 2; j++) {
+                // the finer cell as a local index (along the halved axis) into its tile
+                uint32_t local = 2 * (along_t ? t : f) + j;
+                uint64_t cell = finer_first + local;
+                if (cell >= finer_cells) {
+                    continue;
+                }
+                if (from_source) {
+                    T amplitude = along_t ? source_.amplitudes(uint32_t(cell))[first_f + f]
+                                          : source_.amplitudes(uint32_t(first_t + t))[cell];
+                    max = std::max(max, amplitude);
+                    sum += amplitude;
+                    count += 1;
+                    continue;
+                }
+                const tile &child = *children[local / S];
+                std::size_t i = along_t ? (local % S) * S + f : t * S + local % S;
+                // only the halved axis' length differs between the two, so it's all the mean needs
+                double length = double(along_t ? cell_length(n_frames, finer.level_t, cell)
+                                               : cell_length(n_freq, finer.level_f, cell));
+                max = std::max(max, child.max[i]);
+                sum += child.mean[i] * length;
+                count += length;
+            }
+            out->max[t * S + f] = max;
+            out->mean[t * S + f] = static_cast<T>(sum / count);
+        }
+    }
+    return out;
+}
+
+template <typename T>
+void spectrogram_pyramid<T>::render(double frame_begin, double frame_end, double bin_begin, double bin_end,
+    uint32_t width, uint32_t height, pyramid_reduce reduce, T *out) {
+    constexpr uint32_t S = tile_size;
+    std::fill(out, out + std::size_t(width) * height, T(0));
+    if (width == 0 || height == 0 || source_.empty() || !(frame_end > frame_begin) || !(bin_end > bin_begin)) {
+        return;
+    }
+
+    uint64_t n_frames = source_.n_frames(), n_freq = source_.n_freq();
+    double frames_per_px = (frame_end - frame_begin) / width, bins_per_px = (bin_end - bin_begin) / height;
+    uint32_t level_t = pick_level(frames_per_px, n_time_levels_);
+    uint32_t level_f = pick_level(bins_per_px, n_freq_levels_);
+
+    // cells [first, last) of the level under each pixel column/row, empty outside the spectrogram
+    struct span {
+        uint64_t first, last;
+    };
+    auto spans = [](double begin, double per_px, uint32_t n_px, uint32_t level, uint64_t n) {
+        double scale = std::exp2(level);
+        auto cells = double(n_cells(n, level));
+        std::vector<span> out(n_px);
+        for (uint32_t p = 0; p < n_px; p++) {
+            double a = (begin + p * per_px) / scale, b = (begin + (p + 1) * per_px) / scale;
+            if (b <= 0 || a >= cells) {
+                out[p] = {0, 0};
+                continue;
+            }
+            auto first = uint64_t(std::max(0., std::floor(a)));
+            auto last = uint64_t(std::min(cells, std::max(double(first + 1), std::ceil(b))));
+            out[p] = {first, last};
+        }
+        return out;
+    };
+    auto columns = spans(frame_begin, frames_per_px, width, level_t, n_frames);
+    auto rows = spans(bin_begin, bins_per_px, height, level_f, n_freq);
+
+    // fetch every tile the view touches once, instead of going through the cache per cell
+    uint64_t min_t = UINT64_MAX, max_t = 0, min_f = UINT64_MAX, max_f = 0;
+    for (auto [first, last] : columns) {
+        if (first < last) {
+            min_t = std::min(min_t, first / S);
+            max_t = std::max(max_t, (last - 1) / S);
+        }
+    }
+    for (auto [first, last] : rows) {
+        if (first < last) {
+            min_f = std::min(min_f, first / S);
+            max_f = std::max(max_f, (last - 1) / S);
+        }
+    }
+    if (min_t > max_t || min_f > max_f) {
+        return;
+    }
+
+    // zoomed in to level (0, 0), the cells are the spectrogram's own amplitudes
+    if (level_t == 0 && level_f == 0) {
+        for (uint32_t y = 0; y < height; y++) {
+            auto row = rows[y];
+            for (uint32_t x = 0; x < width; x++) {
+                auto column = columns[x];
+                T max = 0;
+                double sum = 0, count = 0;
+                for (uint64_t ct = column.first; ct < column.last; ct++) {
+                    const T *amplitudes = source_.amplitudes(uint32_t(ct));
+                    for (uint64_t cf = row.first; cf < row.last; cf++) {
+                        max = std::max(max, amplitudes[cf]);
+                        sum += amplitudes[cf];
+                        count += 1;
+                    }
+                }
+                out[std::size_t(y) * width + x] = reduce == pyramid_reduce::max ? max
+                    : count > 0 ? static_cast<T>(sum / count) : T(0);
+            }
+        }
+        return;
+    }
+
+    uint64_t tiles_f = max_f - min_f + 1;
+    std::vector<std::shared_ptr<const tile>> tiles((max_t - min_t + 1) * tiles_f);
+    for (uint64_t tt = min_t; tt <= max_t; tt++) {
+        for (uint64_t tf = min_f; tf <= max_f; tf++) {
+            tiles[(tt - min_t) * tiles_f + tf - min_f] = get(level_t, level_f, uint32_t(tt), uint32_t(tf));
+        }
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        auto row = rows[y];
+        for (uint32_t x = 0; x < width; x++) {
+            auto column = columns[x];
+            T max = 0;
+            double sum = 0, count = 0;
+            for (uint64_t ct = column.first; ct < column.last; ct++) {
+                for (uint64_t cf = row.first; cf < row.last; cf++) {
+                    const tile &t = *tiles[(ct / S - min_t) * tiles_f + cf / S - min_f];
+                    std::size_t i = (ct % S) * S + cf % S;
+                    if (reduce == pyramid_reduce::max) {
+                        max = std::max(max, t.max[i]);
+                    } else {
+                        double weight = double(cell_length(n_frames, level_t, ct) * cell_length(n_freq, level_f, cf));
+                        sum += t.mean[i] * weight;
+                        count += weight;
+                    }
+                }
+            }
+            out[std::size_t(y) * width + x] = reduce == pyramid_reduce::max ? max
+                : count > 0 ? static_cast<T>(sum / count) : T(0);
+        }
+    }
+}
+
+template <typename T>
+void spectrogram_pyramid<T>::evict(std::size_t capacity) {
+    std::size_t bytes = 2 * tile_size * tile_size * sizeof(T);
+    while (bytes_ > capacity && !lru_.empty()) {
+        index_.erase(lru_.back().k);
+        lru_.pop_back();
+        bytes_ -= bytes;
+        evictions_++;
+    }
+}
+
+template <typename T>
+spectrogram_pyramid_stats spectrogram_pyramid<T>::stats() const {
+    std::lock_guard lock(mutex_);
+    return {hits_, misses_, evictions_, lru_.size(), bytes_, capacity_};
+}
+
+template <typename T>
+void spectrogram_pyramid<T>::set_capacity(std::size_t bytes) {
+    std::lock_guard lock(mutex_);
+    capacity_ = bytes;
+    evict(capacity_);
+}
+
+template <typename T>
+void spectrogram_pyramid<T>::clear() {
+    std::lock_guard lock(mutex_);
+    evict(0);
+}
+
+template struct spectrogram_pyramid<float>;
+template struct spectrogram_pyramid<double>;
+
+}
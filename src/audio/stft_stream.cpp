@@ -0,0 +1,129 @@
+#include "audio/stft_stream.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "audio.hpp"
+#include "frame.hpp"
+
+namespace audio {
+
+static uint32_t checked_window_size(uint32_t n_window_offset, uint32_t n_window_size) {
+    if (n_window_size == 0 || n_window_offset == 0) {
+        throw std::invalid_argument("stft_stream needs a nonzero window size and offset");
+    }
+    return n_window_size;
+}
+
+stft_stream::stft_stream(uint32_t samples_per_sec, uint32_t n_window_offset, uint32_t n_window_size,
+    const window &win)
+    : samples_per_sec_{samples_per_sec}, n_window_offset_{n_window_offset}, n_window_size_{n_window_size},
+      n_freq_{stft_bins(n_window_size)}, win_{win}, plan_(checked_window_size(n_window_offset, n_window_size)) {
+    prepared_window prepared(win, n_window_size);
+    coefficients_ = prepared.coefficients;
+    amp_scale_ = prepared.amp_scale;
+
+    ring_.resize(std::size_t(n_window_size) * 2);
+    buffer_.resize(n_window_size + 2);
+    frame_.resize(n_freq_);
+    reset();
+}
+
+void stft_stream::reset() {
+    restart();
+    queue_.clear();
+    queue_index_.clear();
+    queue_head_ = 0;
+}
+
+void stft_stream::restart() {
+    std::fill(ring_.begin(), ring_.end(), 0.f);
+    pos_ = 0;
+    n_samples_ = 0;
+    n_frames_ = 0;
+    next_end_ = n_window_size_;
+}
+
+void stft_stream::push(uint32_t n_samples, const float *input, uint32_t in_spacing, const frame_fn &on_frame) {
+    while (n_samples > 0) {
+        // copy up to whichever comes first: the end of the input, the next frame, or the end of the ring
+        uint64_t until_frame = next_end_ - n_samples_;
+        uint32_t count = uint32_t(std::min<uint64_t>({n_samples, until_frame, n_window_size_ - pos_}));
+        float *first = ring_.data() + pos_;
+        float *second = first + n_window_size_;
+        for (uint32_t i = 0; i < count; i++) {
+            first[i] = second[i] = input[std::size_t(i) * in_spacing];
+        }
+
+        input += std::size_t(count) * in_spacing;
+        n_samples -= count;
+        n_samples_ += count;
+        pos_ += count;
+        if (pos_ == n_window_size_) {
+            pos_ = 0;
+        }
+
+        if (n_samples_ == next_end_) {
+            emit(on_frame);
+        }
+    }
+}
+
+void stft_stream::push(uint32_t n_samples, const float *input, uint32_t in_spacing) {
+    push(n_samples, input, in_spacing, [this](std::span<const wave_data> waves, uint64_t index) {
+        // drop the popped frames once they're half the queue, so a consumer that stays a few frames behind doesn't
+        // make it grow forever, and moving the rest costs O(1) per frame over time
+        if (queue_head_ > 0 && queue_head_ * 2 >= queue_index_.size()) {
+            queue_.erase(queue_.begin(), queue_.begin() + std::ptrdiff_t(queue_head_ * n_freq_));
+            queue_index_.erase(queue_index_.begin(), queue_index_.begin() + std::ptrdiff_t(queue_head_));
+            queue_head_ = 0;
+        }
+        queue_.insert(queue_.end(), waves.begin(), waves.end());
+        queue_index_.push_back(index);
+    });
+}
+
+bool stft_stream::pop(std::vector<wave_data> &waves, uint64_t *index) {
+    if (queue_head_ == queue_index_.size()) {
+        return false;
+    }
+
+    auto first = queue_.begin() + queue_head_ * n_freq_;
+    waves.assign(first, first + n_freq_);
+    if (index) {
+        *index = queue_index_[queue_head_];
+    }
+    queue_head_++;
+    return true;
+}
+
+void stft_stream::emit(const frame_fn &on_frame) {
+    // pos_ is one past the newest sample, so [pos_, pos_ + n_window_size) holds the window oldest first
+    plan_ft(plan_, buffer_, ring_.data() + pos_, 1, samples_per_sec_, coefficients_ ? coefficients_->data() : nullptr,
+        amp_scale_, n_freq_, frame_.data());
+    next_end_ += n_window_offset_;
+    on_frame(frame_, n_frames_++);
+}
+
+void stft_stream::flush(const frame_fn &on_frame) {
+    // same as naive_stft, a signal shorter than one window gives no frames at all
+    if (n_frames_ > 0) {
+        // windows start every n_window_offset samples, the first one that didn't fit starts here.
+        // each gets the samples it has followed by zeros, like naive_stft's tail frames
+        std::vector<float> padded(n_window_size_);
+        for (uint64_t offset = n_frames_ * n_window_offset_; offset < n_samples_; offset += n_window_offset_) {
+            auto length = uint32_t(n_samples_ - offset);
+            const float *first = ring_.data() + pos_ + n_window_size_ - length;
+            std::fill(std::copy(first, first + length, padded.begin()), padded.end(), 0.f);
+            plan_ft(plan_, buffer_, padded.data(), 1, samples_per_sec_,
+                coefficients_ ? coefficients_->data() : nullptr, amp_scale_, n_freq_, frame_.data());
+            on_frame(frame_, n_frames_++);
+        }
+    }
+    restart();
+}
+
+}
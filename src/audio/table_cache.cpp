@@ -0,0 +1,81 @@
+#include "audio/table_cache.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace audio {
+
+table_cache &table_cache::global() {
+    static table_cache cache;
+    return cache;
+}
+
+table_cache::table_cache(std::size_t capacity) :
+        bytes_{0}, capacity_{capacity}, hits_{0}, misses_{0}, evictions_{0} {}
+
+std::shared_ptr<const void> table_cache::find(const table_key &key) {
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        misses_++;
+        return nullptr;
+    }
+
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->table;
+}
+
+std::shared_ptr<const void> table_cache::insert(const table_key &key, std::shared_ptr<const void> table, std::size_t bytes) {
+    std::lock_guard lock(mutex_);
+    if (auto it = index_.find(key); it != index_.end()) {
+        // someone else built the same table while we were building ours, keep theirs so everyone shares one
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->table;
+    }
+
+    if (bytes > capacity_) { // would evict everything and still not fit, so just don't cache it
+        return table;
+    }
+
+    evict(capacity_ - bytes);
+    lru_.push_front({key, table, bytes});
+    index_.emplace(key, lru_.begin());
+    bytes_ += bytes;
+    return table;
+}
+
+void table_cache::evict(std::size_t capacity) {
+    while (bytes_ > capacity && !lru_.empty()) {
+        const auto &oldest = lru_.back();
+        bytes_ -= oldest.bytes;
+        index_.erase(oldest.key);
+        lru_.pop_back();
+        evictions_++;
+    }
+}
+
+table_cache_stats table_cache::stats() const {
+    std::lock_guard lock(mutex_);
+    return {hits_, misses_, evictions_, lru_.size(), bytes_, capacity_};
+}
+
+std::size_t table_cache::capacity() const {
+    std::lock_guard lock(mutex_);
+    return capacity_;
+}
+
+void table_cache::set_capacity(std::size_t bytes) {
+    std::lock_guard lock(mutex_);
+    capacity_ = bytes;
+    evict(capacity_);
+}
+
+void table_cache::clear() {
+    std::lock_guard lock(mutex_);
+    evict(0);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "audio/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace audio {
+
+// the worker index of the current thread while it's inside a parallel_for, so nested calls can run inline
+static thread_local const thread_pool *current_pool = nullptr;
+static thread_local unsigned current_worker = 0;
+
+// chunk indices [begin, end) still waiting to be run by one worker
+struct chunk_range {
+    std::mutex mutex;
+    std::size_t begin;
+    std::size_t end;
+};
+
+struct thread_pool::job {
+    const thread_pool *pool;
+    const range_fn *fn;
+    std::size_t n;
+    std::size_t grain;
+    unsigned n_workers;
+    std::unique_ptr<chunk_range[]> ranges;
+    unsigned active; // workers inside run(), guarded by the pool's mutex_
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+thread_pool::thread_pool(unsigned n_threads) : job_{nullptr}, generation_{0}, stop_{false} {
+    if (n_threads == 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads_.reserve(n_threads - 1);
+    for (unsigned i = 1; i < n_threads; i++) {
+        threads_.emplace_back(&thread_pool::worker_loop, this, i);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &t : threads_) {
+        t.join();
+    }
+}
+
+thread_pool &thread_pool::global() {
+    static thread_pool pool([]{
+        const char *env = std::getenv("AUDIO_THREADS");
+        return env ? unsigned(std::max(0l, std::strtol(env, nullptr, 10))) : 0u;
+    }());
+    return pool;
+}
+
+void thread_pool::parallel_for(std::size_t n, std::size_t grain, const range_fn &fn, unsigned max_workers) {
+    if (n == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t n_chunks = (n + grain - 1) / grain;
+
+    unsigned n_workers = size();
+    if (max_workers) {
+        n_workers = std::min(n_workers, max_workers);
+    }
+    n_workers = unsigned(std::min<std::size_t>(n_workers, n_chunks));
+
+    if (current_pool || n_workers <= 1) {
+        // nested inside another parallel_for, or nothing to split up
+        for (std::size_t begin = 0; begin < n; begin += grain) {
+            fn(begin, std::min(n, begin + grain), current_pool ? current_worker : 0);
+        }
+        return;
+    }
+
+    std::lock_guard submit_lock(submit_mutex_);
+
+    job j{this, &fn, n, grain, n_workers, std::make_unique<chunk_range[]>(n_workers), 1, {}, nullptr};
+    for (unsigned w = 0; w < n_workers; w++) {
+        j.ranges[w].begin = n_chunks * w / n_workers;
+        j.ranges[w].end = n_chunks * (w + 1) / n_workers;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        job_ = &j;
+        generation_++;
+    }
+    wake_.notify_all();
+
+    run(j, 0);
+
+    {
+        std::unique_lock lock(mutex_);
+        j.active--;
+        done_.wait(lock, [&]{ return j.active == 0; });
+        job_ = nullptr;
+    }
+
+    if (j.error) {
+        std::rethrow_exception(j.error);
+    }
+}
+
+void thread_pool::worker_loop(unsigned id) {
+    std::size_t seen = 0;
+    while (true) {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [&]{ return stop_ || generation_ != seen; });
+        if (stop_) {
+            return;
+        }
+        seen = generation_;
+        if (!job_ || id >= job_->n_workers) {
+            continue;
+        }
+
+        job &j = *job_;
+        j.active++;
+        lock.unlock();
+
+        run(j, id);
+
+        lock.lock();
+        if (--j.active == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void thread_pool::run(job &j, unsigned id) {
+    current_pool = j.pool;
+    current_worker = id;
+
+    chunk_range &own = j.ranges[id];
+    while (true) {
+        std::size_t chunk = 0;
+        bool found = false;
+        {
+            std::lock_guard lock(own.mutex);
+            if (own.begin < own.end) {
+                chunk = own.begin++;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            // out of work, steal the back half of the fullest range
+            unsigned victim = id;
+            std::size_t most = 0;
+            for (unsigned w = 0; w < j.n_workers; w++) {
+                std::lock_guard lock(j.ranges[w].mutex);
+                if (j.ranges[w].end - j.ranges[w].begin > most) {
+                    most = j.ranges[w].end - j.ranges[w].begin;
+                    victim = w;
+                }
+            }
+            if (most == 0) {
+                break;
+            }
+
+            std::size_t stolen_begin, stolen_end;
+            {
+                std::lock_guard lock(j.ranges[victim].mutex);
+                auto &r = j.ranges[victim];
+                if (r.begin == r.end) {
+                    continue; // someone else got there first, look again
+                }
+                stolen_end = r.end;
+                stolen_begin = r.end - (r.end - r.begin + 1) / 2;
+                r.end = stolen_begin;
+            }
+            std::lock_guard lock(own.mutex);
+            own.begin = stolen_begin;
+            own.end = stolen_end;
+            continue;
+        }
+
+        try {
+            std::size_t begin = chunk * j.grain;
+            (*j.fn)(begin, std::min(j.n, begin + j.grain), id);
+        } catch (...) {
+            std::lock_guard lock(j.error_mutex);
+            if (!j.error) {
+                j.error = std::current_exception();
+            }
+        }
+    }
+
+    current_pool = nullptr;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "audio/window.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio/table_cache.hpp"
+
+namespace audio {
+
+const char *window_name(window_type type) {
+    switch (type) {
+    case window_type::rectangular:     return "rectangular";
+    case window_type::hann:            return "hann";
+    case window_type::hamming:         return "hamming";
+    case window_type::blackman_harris: return "blackman-harris";
+    case window_type::kaiser:          return "kaiser";
+    case window_type::flat_top:        return "flat-top";
+    }
+    return "unknown";
+}
+
+double kaiser_coefficient(double beta, uint32_t i, uint32_t n) {
+    double r = 2. * i / n - 1;
+    return std::cyl_bessel_i(0., beta * std::sqrt(1 - r * r)) / std::cyl_bessel_i(0., beta);
+}
+
+double window_coefficient(const window &w, uint32_t i, uint32_t n) {
+    switch (w.type) {
+    case window_type::rectangular:     return rectangular_window::coefficient(i, n);
+    case window_type::hann:            return hann_window::coefficient(i, n);
+    case window_type::hamming:         return hamming_window::coefficient(i, n);
+    case window_type::blackman_harris: return blackman_harris_window::coefficient(i, n);
+    case window_type::kaiser:          return kaiser_coefficient(w.param, i, n);
+    case window_type::flat_top:        return flat_top_window::coefficient(i, n);
+    }
+    return 1;
+}
+
+std::vector<double> cosine_sum_terms(const window &w) {
+    // these have to match the policies' coefficient()
+    switch (w.type) {
+    case window_type::rectangular:     return {1};
+    case window_type::hann:            return {0.5, 0.5};
+    case window_type::hamming:         return {0.54, 0.46};
+    case window_type::blackman_harris: return {0.35875, 0.48829, 0.14128, 0.01168};
+    case window_type::kaiser:          return {};
+    case window_type::flat_top:        return {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+    }
+    return {};
+}
+
+bool is_cola(const window &w, uint32_t n, uint32_t offset, double tolerance) {
+    if (n == 0 || offset == 0 || offset > n) {
+        return false;
+    }
+
+    // folding the squared window onto one period of the offset gives the sum every sample sees
+    std::vector<double> sums(offset);
+    for (uint32_t i = 0; i < n; i++) {
+        double c = window_coefficient(w, i, n);
+        sums[i % offset] += c * c;
+    }
+
+    auto [min, max] = std::minmax_element(sums.begin(), sums.end());
+    return *max > 0 && *max - *min <= tolerance * *max;
+}
+
+static table_kind window_table_kind(window_type type) {
+    switch (type) {
+    case window_type::rectangular:     return table_kind::rectangular_window;
+    case window_type::hann:            return table_kind::hann_window;
+    case window_type::hamming:         return table_kind::hamming_window;
+    case window_type::blackman_harris: return table_kind::blackman_harris_window;
+    case window_type::kaiser:          return table_kind::kaiser_window;
+    case window_type::flat_top:        return table_kind::flat_top_window;
+    }
+    return table_kind::rectangular_window;
+}
+
+template <typename T>
+std::vector<T> make_window(const window &w, uint32_t n) {
+    std::vector<T> coefficients(n);
+    for (uint32_t i = 0; i < n; i++) {
+        coefficients[i] = static_cast<T>(window_coefficient(w, i, n));
+    }
+    return coefficients;
+}
+
+template <typename T>
+std::shared_ptr<const std::vector<T>> window_coefficients(const window &w, uint32_t n) {
+    return table_cache::global().get<T>(window_table_kind(w.type), n, w.param, [&]{
+        return make_window<T>(w, n);
+    });
+}
+
+template std::vector<float> make_window<float>(const window &, uint32_t);
+template std::vector<double> make_window<double>(const window &, uint32_t);
+template std::shared_ptr<const std::vector<float>> window_coefficients<float>(const window &, uint32_t);
+template std::shared_ptr<const std::vector<double>> window_coefficients<double>(const window &, uint32_t);
+
+}
\ No newline at end of file